@@ -14,21 +14,6 @@ namespace BinaryData
     extern const char*   UbuntuLight_ttf;
     const int            UbuntuLight_ttfSize = 413600;
 
-    extern const char*   large_church_wav;
-    const int            large_church_wavSize = 768044;
-
-    extern const char*   large_hall_wav;
-    const int            large_hall_wavSize = 3341002;
-
-    extern const char*   medium_chamber_wav;
-    const int            medium_chamber_wavSize = 1382674;
-
-    extern const char*   medium_hall_wav;
-    const int            medium_hall_wavSize = 1588186;
-
-    extern const char*   open_air_wav;
-    const int            open_air_wavSize = 415144;
-
     extern const char*   graph_placeholder_png;
     const int            graph_placeholder_pngSize = 32183;
 
@@ -39,7 +24,7 @@ namespace BinaryData
     extern const char* namedResourceList[];
 
     // Number of elements in the namedResourceList array.
-    const int namedResourceListSize = 9;
+    const int namedResourceListSize = 4;
 
     // If you provide the name of one of the binary resource variables above, this function will
     // return the corresponding data and its size (or a null pointer if the name isn't found).
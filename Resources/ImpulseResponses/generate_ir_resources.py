@@ -0,0 +1,250 @@
+#!/usr/bin/env python3
+"""Converts the banked impulse responses to pre-decoded float arrays.
+
+Generates, from every WAV file in this directory:
+    Source/IRResources.h    metadata table (name, sample rate, channels, length,
+                            content hash)
+    Source/IRResources.cpp  samples as aligned float arrays (not tracked by git)
+
+so the IR bank can use them in place, without decoding anything at startup.
+
+Run by the quantumVERB_SharedCode pre-build step; outputs are only rewritten when
+an IR changed. Usage: generate_ir_resources.py [--force]
+"""
+import glob
+import hashlib
+import os
+import struct
+import sys
+
+IR_DIR = os.path.dirname(os.path.abspath(__file__))
+SOURCE_DIR = os.path.join(IR_DIR, '..', '..', 'Source')
+
+HEADER_PATH = os.path.join(SOURCE_DIR, 'IRResources.h')
+SOURCE_PATH = os.path.join(SOURCE_DIR, 'IRResources.cpp')
+
+# Channels are padded to a multiple of this many samples, so each one is aligned
+ALIGNMENT_BYTES = 16
+ALIGNMENT_SAMPLES = ALIGNMENT_BYTES // 4
+
+WAVE_FORMAT_PCM = 1
+WAVE_FORMAT_IEEE_FLOAT = 3
+WAVE_FORMAT_EXTENSIBLE = 0xFFFE
+
+VALUES_PER_LINE = 8
+
+# Hex digits of the SHA-256 of each WAV file kept as its content hash
+CONTENT_HASH_DIGITS = 16
+
+
+def read_wav(path):
+    """Returns (sample rate, list of channels) with samples in [-1, 1]."""
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if data[0:4] != b'RIFF' or data[8:12] != b'WAVE':
+        raise ValueError(path + ': not a WAVE file')
+
+    fmt = None
+    samples = None
+    pos = 12
+
+    while pos + 8 <= len(data):
+        chunk_id = data[pos:pos + 4]
+        chunk_size = struct.unpack_from('<I', data, pos + 4)[0]
+        chunk = data[pos + 8:pos + 8 + chunk_size]
+
+        if chunk_id == b'fmt ':
+            fmt = struct.unpack_from('<HHIIHH', chunk)
+            if fmt[0] == WAVE_FORMAT_EXTENSIBLE:
+                # Actual format is the start of the sub-format GUID
+                fmt = (struct.unpack_from('<H', chunk, 24)[0],) + fmt[1:]
+        elif chunk_id == b'data':
+            samples = chunk
+
+        pos += 8 + chunk_size + (chunk_size & 1)
+
+    if fmt is None or samples is None:
+        raise ValueError(path + ': missing fmt or data chunk')
+
+    audio_format, num_channels, sample_rate, _, block_align, bits = fmt
+    num_frames = len(samples) // block_align
+    width = bits // 8
+
+    if audio_format == WAVE_FORMAT_IEEE_FLOAT and bits == 32:
+        values = struct.unpack_from('<%df' % (num_frames * num_channels), samples)
+    elif audio_format == WAVE_FORMAT_PCM and bits in (16, 24, 32):
+        scale = 1.0 / (1 << (bits - 1))
+        values = []
+        for i in range(num_frames * num_channels):
+            raw = samples[i * width:(i + 1) * width]
+            values.append(int.from_bytes(raw, 'little', signed=True) * scale)
+    else:
+        raise ValueError('%s: unsupported format %d (%d bits)' % (path, audio_format, bits))
+
+    channels = [values[c::num_channels] for c in range(num_channels)]
+    return sample_rate, channels
+
+
+def format_float(value):
+    # 9 significant digits round-trip any float
+    text = '%.9g' % value
+    if '.' not in text and 'e' not in text:
+        text += '.0'
+    return text + 'f'
+
+
+def content_hash(path):
+    """Identifies the IR's contents, e.g. for caches of IRs processed from it."""
+    with open(path, 'rb') as f:
+        return hashlib.sha256(f.read()).hexdigest()[:CONTENT_HASH_DIGITS]
+
+
+def resource_name(path):
+    # Same names as the BinaryData resources the IRs used to be (they are saved in
+    # plugin states)
+    return os.path.basename(path).replace('.', '_')
+
+
+def generate(wav_paths):
+    irs = []
+    for path in wav_paths:
+        sample_rate, channels = read_wav(path)
+        irs.append((resource_name(path), content_hash(path), sample_rate, channels))
+
+    header = [
+        '/*',
+        '  ' + '=' * 78,
+        '',
+        '    IRResources.h',
+        '',
+        '    Generated by Resources/ImpulseResponses/generate_ir_resources.py',
+        '    (do not edit)',
+        '',
+        '  ' + '=' * 78,
+        '*/',
+        '',
+        '#pragma once',
+        '',
+        'namespace reverb',
+        '{',
+        '',
+        '    namespace IRResources',
+        '    {',
+        '',
+        '        struct Info',
+        '        {',
+        '            const char* name;',
+        '            double sampleRate;',
+        '            int numChannels;',
+        '            int numSamples;',
+        '',
+        '            // Distance between the start of two channels in samples (channels are',
+        '            // padded so each one is %d-byte aligned)' % ALIGNMENT_BYTES,
+        '            int channelStride;',
+        '',
+        '            // Start of the SHA-256 of the IR file (changes whenever the IR does)',
+        '            const char* contentHash;',
+        '        };',
+        '',
+        '        constexpr int NUM_IRS = %d;' % len(irs),
+        '',
+        '        constexpr Info infos[NUM_IRS] = {',
+    ]
+
+    for name, hash_, sample_rate, channels in irs:
+        num_samples = len(channels[0])
+        stride = -(-num_samples // ALIGNMENT_SAMPLES) * ALIGNMENT_SAMPLES
+        header.append('            { "%s", %.1f, %d, %d, %d, "%s" },'
+                      % (name, sample_rate, len(channels), num_samples, stride, hash_))
+
+    header += [
+        '        };',
+        '',
+        '        // Samples of each IR, channel after channel',
+        '        extern const float* const samples[NUM_IRS];',
+        '',
+        '    }',
+        '',
+        '}',
+        '',
+    ]
+
+    source = [
+        '/*',
+        '  ' + '=' * 78,
+        '',
+        '    IRResources.cpp',
+        '',
+        '    Generated by Resources/ImpulseResponses/generate_ir_resources.py',
+        '    (do not edit)',
+        '',
+        '  ' + '=' * 78,
+        '*/',
+        '',
+        '#include "IRResources.h"',
+        '',
+        'namespace reverb',
+        '{',
+        '',
+        '    namespace IRResources',
+        '    {',
+        '',
+    ]
+
+    for name, _, _, channels in irs:
+        num_samples = len(channels[0])
+        stride = -(-num_samples // ALIGNMENT_SAMPLES) * ALIGNMENT_SAMPLES
+
+        values = []
+        for channel in channels:
+            values += [format_float(v) for v in channel]
+            values += ['0.0f'] * (stride - num_samples)
+
+        source.append('        alignas(%d) static const float %s[] = {' % (ALIGNMENT_BYTES, name))
+        for i in range(0, len(values), VALUES_PER_LINE):
+            source.append('            ' + ', '.join(values[i:i + VALUES_PER_LINE]) + ',')
+        source += ['        };', '']
+
+    source.append('        const float* const samples[NUM_IRS] = {')
+    for name, _, _, _ in irs:
+        source.append('            %s,' % name)
+    source += [
+        '        };',
+        '',
+        '    }',
+        '',
+        '}',
+        '',
+    ]
+
+    return '\n'.join(header), '\n'.join(source)
+
+
+def is_up_to_date(wav_paths):
+    outputs = [HEADER_PATH, SOURCE_PATH, os.path.abspath(__file__)]
+    if not all(os.path.exists(p) for p in outputs[:2]):
+        return False
+
+    last_output = min(os.path.getmtime(p) for p in outputs[:2])
+    last_input = max(os.path.getmtime(p) for p in wav_paths + [outputs[2]])
+
+    return last_output >= last_input
+
+
+def main():
+    wav_paths = sorted(glob.glob(os.path.join(IR_DIR, '*.wav')))
+
+    if '--force' not in sys.argv and is_up_to_date(wav_paths):
+        return
+
+    header, source = generate(wav_paths)
+
+    with open(HEADER_PATH, 'w', newline='\n') as f:
+        f.write(header)
+    with open(SOURCE_PATH, 'w', newline='\n') as f:
+        f.write(source)
+
+
+if __name__ == '__main__':
+    main()
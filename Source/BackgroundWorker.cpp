@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    BackgroundWorker.cpp
+
+  ==============================================================================
+*/
+
+#include "BackgroundWorker.h"
+
+#include "Logger.h"
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * @brief Constructs a BackgroundWorker and starts its thread
+     *
+     * @param [in] handler      Function running a command (called on the worker thread)
+     * @param [in] numTargets   Number of distinct command targets (0 to numTargets - 1)
+     */
+    BackgroundWorker::BackgroundWorker(Handler handler, int numTargets)
+        : handler(handler),
+          queue(QUEUE_SIZE),
+          pendingCommands(numTargets),
+          isPending(numTargets, false)
+    {
+        thread = std::thread(&BackgroundWorker::run, this);
+    }
+
+    /**
+     * @brief Stops the worker thread, dropping any commands not yet run
+     */
+    BackgroundWorker::~BackgroundWorker()
+    {
+        shouldExit = true;
+        wakeUp.signal();
+
+        thread.join();
+    }
+
+    //==============================================================================
+    /**
+     * @brief Posts a command to the worker (realtime-safe)
+     *
+     * Must only be called from one thread at a time. The command runs as soon as the
+     * worker is done with earlier ones, unless it is superseded by a later command for
+     * the same target. The worker is only signalled if it is asleep.
+     *
+     * @param [in] command  Command to run
+     *
+     * @returns False if the queue is full (the command is dropped)
+     */
+    bool BackgroundWorker::post(const Command& command)
+    {
+        jassert(command.target >= 0 && command.target < (int)pendingCommands.size());
+
+        if (!queue.push(command))
+        {
+            return false;
+        }
+
+        // Pairs with the fence in run(): either the worker sees the command before going
+        // to sleep, or we see it asleep
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (isSleeping.exchange(false))
+        {
+            wakeUp.signal();
+        }
+
+        return true;
+    }
+
+    //==============================================================================
+    /**
+     * @brief Worker thread body: drain queue, keep latest command per target, run them
+     */
+    void BackgroundWorker::run()
+    {
+        while (!shouldExit)
+        {
+            Command command;
+            bool hasCommands = false;
+
+            while (queue.pop(command))
+            {
+                pendingCommands[command.target] = command;
+                isPending[command.target] = true;
+                hasCommands = true;
+            }
+
+            if (!hasCommands)
+            {
+                // Announce we are going to sleep, then check again for commands posted
+                // before the announcement could be seen
+                isSleeping = true;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                if (queue.isEmpty() && !shouldExit)
+                {
+                    wakeUp.wait();
+                }
+
+                isSleeping = false;
+                continue;
+            }
+
+            for (size_t target = 0; target < pendingCommands.size() && !shouldExit; ++target)
+            {
+                if (!isPending[target])
+                {
+                    continue;
+                }
+
+                isPending[target] = false;
+
+                // Keep worker alive if a command fails: the next one may succeed
+                try
+                {
+                    handler(pendingCommands[target]);
+                }
+                catch (const std::exception& e)
+                {
+                    std::string errMsg = "Background command failed due to exception: ";
+                    errMsg += e.what();
+
+                    logger.dualPrint(Logger::Level::Error, errMsg);
+                }
+            }
+        }
+    }
+
+}
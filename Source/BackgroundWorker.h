@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    BackgroundWorker.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#include "Semaphore.h"
+#include "SPSCQueue.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * Long-lived background thread running commands posted by the audio thread.
+     *
+     * Commands go through a lock-free SPSC queue, so posting never allocates or locks.
+     * The worker sleeps until commands arrive: only a post that finds it asleep signals
+     * its (lock-free) semaphore, with one system call per burst of requests and none while
+     * it is busy. It drains the
+     * queue and collapses all commands for the same target into the latest one before
+     * running it, so a burst of requests only results in one (up to date) run.
+     */
+    class BackgroundWorker
+    {
+    public:
+        //==============================================================================
+        struct Command
+        {
+            int target = 0;
+            double value = 0.0;
+        };
+
+        using Handler = std::function<void(const Command&)>;
+
+        //==============================================================================
+        BackgroundWorker(Handler handler, int numTargets);
+        ~BackgroundWorker();
+
+        BackgroundWorker(const BackgroundWorker&) = delete;
+        BackgroundWorker& operator=(const BackgroundWorker&) = delete;
+
+        //==============================================================================
+        bool post(const Command& command);
+
+        //==============================================================================
+        static constexpr int QUEUE_SIZE = 64;
+
+    private:
+        //==============================================================================
+        void run();
+
+        //==============================================================================
+        Handler handler;
+
+        SPSCQueue<Command> queue;
+
+        // Latest command per target, collected while draining the queue
+        std::vector<Command> pendingCommands;
+        std::vector<bool> isPending;
+
+        std::atomic<bool> shouldExit { false };
+
+        // Set by the worker before it waits on wakeUp, cleared by the post waking it up
+        std::atomic<bool> isSleeping { false };
+        Semaphore wakeUp;
+
+        std::thread thread;
+    };
+
+}
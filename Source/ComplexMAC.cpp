@@ -0,0 +1,209 @@
+/*
+  ==============================================================================
+
+    ComplexMAC.cpp
+
+  ==============================================================================
+*/
+
+#include "ComplexMAC.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+
+ // GCC and Clang only emit SIMD instructions in functions targeting them, while
+ // MSVC allows any intrinsic anywhere
+ #if JUCE_MSVC
+  #define REVERB_TARGET(isa)
+ #else
+  #define REVERB_TARGET(isa) __attribute__((target(isa)))
+ #endif
+#endif
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * @brief Portable kernel, also used for the remainder of the SIMD kernels
+     */
+    static void complexMACScalar(float* accRe, float* accIm,
+                                 const float* aRe, const float* aIm,
+                                 const float* bRe, const float* bIm,
+                                 int numBins)
+    {
+        for (int k = 0; k < numBins; ++k)
+        {
+            accRe[k] += aRe[k] * bRe[k] - aIm[k] * bIm[k];
+            accIm[k] += aRe[k] * bIm[k] + aIm[k] * bRe[k];
+        }
+    }
+
+#if JUCE_INTEL
+    /**
+     * @brief SSE2 kernel (4 bins per iteration)
+     */
+    REVERB_TARGET("sse2")
+    static void complexMACSSE2(float* accRe, float* accIm,
+                               const float* aRe, const float* aIm,
+                               const float* bRe, const float* bIm,
+                               int numBins)
+    {
+        const int numVectorBins = numBins & ~3;
+
+        for (int k = 0; k < numVectorBins; k += 4)
+        {
+            const __m128 ar = _mm_loadu_ps(aRe + k);
+            const __m128 ai = _mm_loadu_ps(aIm + k);
+            const __m128 br = _mm_loadu_ps(bRe + k);
+            const __m128 bi = _mm_loadu_ps(bIm + k);
+
+            const __m128 re = _mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi));
+            const __m128 im = _mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br));
+
+            _mm_storeu_ps(accRe + k, _mm_add_ps(_mm_loadu_ps(accRe + k), re));
+            _mm_storeu_ps(accIm + k, _mm_add_ps(_mm_loadu_ps(accIm + k), im));
+        }
+
+        complexMACScalar(accRe + numVectorBins, accIm + numVectorBins,
+                         aRe + numVectorBins, aIm + numVectorBins,
+                         bRe + numVectorBins, bIm + numVectorBins,
+                         numBins - numVectorBins);
+    }
+
+    /**
+     * @brief AVX2+FMA kernel (8 bins per iteration, fused multiply-adds)
+     */
+    REVERB_TARGET("avx2,fma")
+    static void complexMACAVX2(float* accRe, float* accIm,
+                               const float* aRe, const float* aIm,
+                               const float* bRe, const float* bIm,
+                               int numBins)
+    {
+        const int numVectorBins = numBins & ~7;
+
+        for (int k = 0; k < numVectorBins; k += 8)
+        {
+            const __m256 ar = _mm256_loadu_ps(aRe + k);
+            const __m256 ai = _mm256_loadu_ps(aIm + k);
+            const __m256 br = _mm256_loadu_ps(bRe + k);
+            const __m256 bi = _mm256_loadu_ps(bIm + k);
+
+            __m256 re = _mm256_loadu_ps(accRe + k);
+            __m256 im = _mm256_loadu_ps(accIm + k);
+
+            re = _mm256_fmadd_ps(ar, br, re);
+            re = _mm256_fnmadd_ps(ai, bi, re);
+            im = _mm256_fmadd_ps(ar, bi, im);
+            im = _mm256_fmadd_ps(ai, br, im);
+
+            _mm256_storeu_ps(accRe + k, re);
+            _mm256_storeu_ps(accIm + k, im);
+        }
+
+        complexMACScalar(accRe + numVectorBins, accIm + numVectorBins,
+                         aRe + numVectorBins, aIm + numVectorBins,
+                         bRe + numVectorBins, bIm + numVectorBins,
+                         numBins - numVectorBins);
+    }
+#endif
+
+    //==============================================================================
+    /**
+     * @brief Accumulates the bin-wise complex product of two spectra
+     *
+     * Uses the fastest kernel supported by the CPU, which is picked on first use.
+     * Spectra may be unaligned; the accumulator must not alias the inputs.
+     *
+     * @param [in,out] accRe    Real part of accumulator
+     * @param [in,out] accIm    Imaginary part of accumulator
+     * @param [in]     aRe      Real part of first spectrum
+     * @param [in]     aIm      Imaginary part of first spectrum
+     * @param [in]     bRe      Real part of second spectrum
+     * @param [in]     bIm      Imaginary part of second spectrum
+     * @param [in]     numBins  Number of bins
+     */
+    void ComplexMAC::process(float* accRe, float* accIm,
+                             const float* aRe, const float* aIm,
+                             const float* bRe, const float* bIm,
+                             int numBins)
+    {
+        static const Kernel kernel = getKernel(getBestInstructionSet());
+
+        kernel(accRe, accIm, aRe, aIm, bRe, bIm, numBins);
+    }
+
+    //==============================================================================
+    /**
+     * @brief Checks if a kernel is compiled in and can run on the host CPU
+     *
+     * @param [in] instructionSet   Instruction set to check
+     */
+    bool ComplexMAC::isSupported(InstructionSet instructionSet)
+    {
+        switch (instructionSet)
+        {
+#if JUCE_INTEL
+        case InstructionSet::sse2:
+            return juce::SystemStats::hasSSE2();
+
+        case InstructionSet::avx2:
+            return juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3();
+#endif
+
+        case InstructionSet::scalar:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * @brief Returns the fastest instruction set supported by the host CPU
+     */
+    ComplexMAC::InstructionSet ComplexMAC::getBestInstructionSet()
+    {
+        if (isSupported(InstructionSet::avx2))
+        {
+            return InstructionSet::avx2;
+        }
+
+        if (isSupported(InstructionSet::sse2))
+        {
+            return InstructionSet::sse2;
+        }
+
+        return InstructionSet::scalar;
+    }
+
+    /**
+     * @brief Returns the kernel for a given instruction set
+     *
+     * @param [in] instructionSet   Instruction set (must be supported)
+     *
+     * @throws std::invalid_argument
+     */
+    ComplexMAC::Kernel ComplexMAC::getKernel(InstructionSet instructionSet)
+    {
+        if (!isSupported(instructionSet))
+        {
+            throw std::invalid_argument("Complex MAC instruction set not supported by this CPU");
+        }
+
+        switch (instructionSet)
+        {
+#if JUCE_INTEL
+        case InstructionSet::sse2:
+            return complexMACSSE2;
+
+        case InstructionSet::avx2:
+            return complexMACAVX2;
+#endif
+
+        default:
+            return complexMACScalar;
+        }
+    }
+
+}
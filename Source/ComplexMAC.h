@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    ComplexMAC.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * Complex multiply-accumulate kernels for spectra stored in split real/imaginary
+     * (SoA) form, i.e. acc += a * b for every bin. This is the inner loop of
+     * frequency-domain convolution.
+     *
+     * SSE2 and AVX2+FMA versions are compiled on x86 alongside a scalar fallback, and
+     * the fastest one supported by the host CPU is picked at runtime.
+     */
+    class ComplexMAC
+    {
+    public:
+        //==============================================================================
+        enum class InstructionSet
+        {
+            scalar,
+            sse2,
+            avx2
+        };
+
+        using Kernel = void (*)(float* accRe, float* accIm,
+                                const float* aRe, const float* aIm,
+                                const float* bRe, const float* bIm,
+                                int numBins);
+
+        //==============================================================================
+        static void process(float* accRe, float* accIm,
+                            const float* aRe, const float* aIm,
+                            const float* bRe, const float* bIm,
+                            int numBins);
+
+        //==============================================================================
+        static bool isSupported(InstructionSet instructionSet);
+        static InstructionSet getBestInstructionSet();
+        static Kernel getKernel(InstructionSet instructionSet);
+
+    private:
+        //==============================================================================
+        ComplexMAC() = delete;
+    };
+
+}
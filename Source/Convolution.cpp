@@ -8,6 +8,8 @@ Convolution.cpp
 
 #include "Convolution.h"
 
+#include <algorithm>
+
 namespace reverb
 {
 
@@ -20,10 +22,21 @@ namespace reverb
     * @param [in] processor    Pointer to main processor.
     */
     Convolution::Convolution(juce::AudioProcessor* processor)
-        : Task(processor)
+        : Task(processor),
+          fadeBuffer(NUM_TRUE_STEREO_CHANNELS, CROSSFADE_BUFFER_SIZE)
     {
     }
 
+    /**
+    * @brief Destructor. Frees the active and retired engines.
+    *
+    * @details exec() must not be running anymore.
+    */
+    Convolution::~Convolution()
+    {
+        delete activeEngine.exchange(nullptr);
+    }
+
     //==============================================================================
     /**
      * @brief No parameters to update, do nothing
@@ -38,51 +51,403 @@ namespace reverb
      * @brief Main function of the Convolution class. Executes the convolution of
      *        the audio buffer with the IR.
      *
-     * @details Creates a ProcessContext object that specifies the audio buffer to
-     *          convolve and the buffer to contain the resulted signal. Calls the
-     *          juce::dsp::Convolution::process() function to compute the
-     *          convolution.
+     * @details Runs the audio buffer (single channel, or stereo in true-stereo mode)
+     *          through the currently published convolution engine in place. The
+     *          output is delayed by getLatencySamples() samples.
+     *
+     *          Never waits: the engine is picked up with an atomic load, and the exec
+     *          epoch and hazard pointers tell loadIR() when a replaced engine is no
+     *          longer in use.
+     *
+     *          A newly published engine is crossfaded in over the crossfade length. It
+     *          is only picked up once any previous crossfade is complete.
      *
      * @param [in,out] audio    The audio buffer to be convolved with the IR.
      */
     AudioBlock Convolution::exec(AudioBlock audio)
     {
-        juce::dsp::ProcessContextReplacing<float> context(audio);
-        process(context);
+        // Odd epoch while running: mark before picking up the engine
+        execEpoch.fetch_add(1);
+
+        if (fadingEngine == nullptr)
+        {
+            ConvolutionEngine* engine = activeEngine.load();
+
+            if (engine != currentEngine)
+            {
+                const int length = crossfadeLength.load(std::memory_order_relaxed);
+
+                if (currentEngine != nullptr && length > 0)
+                {
+                    fadingEngine = currentEngine;
+                    fadePosition = 0;
+                    fadeLength = length;
+                }
+
+                currentEngine = engine;
+            }
+        }
+
+        if (fadingEngine == nullptr)
+        {
+            processEngine(currentEngine, audio);
+        }
+        else
+        {
+            processCrossfade(audio);
+        }
+
+        // NB: An engine may move from current to fading, so publish fading first
+        // (collectRetiredEngines() reads them in the opposite order)
+        fadingEngineInUse.store(fadingEngine);
+        currentEngineInUse.store(currentEngine);
+
+        execEpoch.fetch_add(1, std::memory_order_release);
 
         return audio;
     }
 
+    /**
+     * @brief Runs the audio buffer through a given engine in place
+     *
+     * @details Clears the buffer if there is no usable engine.
+     *
+     * @param [in]     engine   Engine to run (may be null)
+     * @param [in,out] audio    The audio buffer to be convolved with the engine's IR.
+     */
+    void Convolution::processEngine(ConvolutionEngine* engine, AudioBlock audio)
+    {
+        if (engine == nullptr || !engine->isPrepared() ||
+            audio.getNumChannels() < (size_t)engine->getNumInputs())
+        {
+            audio.clear();
+            return;
+        }
+
+        const int numChannels = engine->getNumInputs();
+
+        float* channels[NUM_TRUE_STEREO_CHANNELS];
+
+        for (int i = 0; i < numChannels; ++i)
+        {
+            channels[i] = audio.getChannelPointer(i);
+        }
+
+        engine->process(channels, channels, (int)audio.getNumSamples());
+    }
+
+    /**
+     * @brief Runs both the fading and current engines and crossfades their outputs
+     *
+     * @details Works in chunks of up to CROSSFADE_BUFFER_SIZE samples: the fading
+     *          engine convolves a copy of the input in fadeBuffer, then its output is
+     *          linearly faded out while the current engine's output is faded in. Once
+     *          the crossfade completes, the fading engine is dropped and the rest of
+     *          the buffer only goes through the current engine.
+     *
+     * @param [in,out] audio    The audio buffer to be convolved with the IR.
+     */
+    void Convolution::processCrossfade(AudioBlock audio)
+    {
+        const size_t numSamples = audio.getNumSamples();
+        const size_t numChannels = std::min(audio.getNumChannels(),
+                                            (size_t)fadeBuffer.getNumChannels());
+        size_t done = 0;
+
+        while (done < numSamples && fadingEngine != nullptr)
+        {
+            const size_t chunkSize = std::min({ numSamples - done,
+                                                (size_t)CROSSFADE_BUFFER_SIZE,
+                                                (size_t)(fadeLength - fadePosition) });
+
+            AudioBlock newAudio = audio.getSubBlock(done, chunkSize);
+            AudioBlock oldAudio = AudioBlock(fadeBuffer).getSubBlock(0, chunkSize);
+
+            for (size_t ch = 0; ch < numChannels; ++ch)
+            {
+                juce::FloatVectorOperations::copy(oldAudio.getChannelPointer(ch),
+                                                  newAudio.getChannelPointer(ch),
+                                                  (int)chunkSize);
+            }
+
+            processEngine(currentEngine, newAudio);
+            processEngine(fadingEngine, oldAudio);
+
+            // Linear ramp from old to new output
+            const float gainStep = 1.0f / fadeLength;
+
+            for (size_t ch = 0; ch < numChannels; ++ch)
+            {
+                float* out = newAudio.getChannelPointer(ch);
+                const float* old = oldAudio.getChannelPointer(ch);
+
+                float gain = fadePosition * gainStep;
+
+                for (size_t i = 0; i < chunkSize; ++i)
+                {
+                    out[i] = old[i] + gain * (out[i] - old[i]);
+                    gain += gainStep;
+                }
+            }
+
+            fadePosition += (int)chunkSize;
+            done += chunkSize;
+
+            numCrossfadeSamples.fetch_add((int64_t)chunkSize, std::memory_order_relaxed);
+
+            if (fadePosition >= fadeLength)
+            {
+                fadingEngine = nullptr;
+            }
+        }
+
+        if (done < numSamples)
+        {
+            processEngine(currentEngine, audio.getSubBlock(done, numSamples - done));
+        }
+    }
+
     //==============================================================================
     /**
-    * @brief Defines the main characteristics of the convolution process and loads
-    *        the IR into the juce::dsp::Convolution object.
+    * @brief Sets up the convolution engine for a given maximum host block size
+    *
+    * @details The head partition size (and thus the latency) follows the host block
+    *          size: small blocks get small head partitions for low latency, while the
+    *          tail of the IR is always handled by large, efficient partitions. If the
+    *          configuration changed, an empty engine is published and any loaded IR
+    *          must be reloaded afterwards.
+    *
+    *          In zero-latency mode, the head partition is convolved in the time domain
+    *          and the convolution adds no delay at all.
+    *
+    *          In true-stereo mode, the engine convolves two inputs with four IR channels.
+    *          Each input is transformed once per partition and shared by both outputs.
     *
-    * @details Calls JUCE Convolution class's functions prepare() and
-    *          copyAndLoadImpulseResponseFromBuffer().
+    *          Must not be called from the audio thread.
+    *
+    * @param [in] maxBlockSize  Maximum expected number of samples per block.
+    * @param [in] zeroLatency   True to use the hybrid FIR/FFT zero-latency mode.
+    * @param [in] trueStereo    True to convolve a stereo signal with a 4-channel IR.
+    *
+    * @returns True if the engine was (re)configured and the IR must be reloaded.
+    */
+    bool Convolution::prepare(int maxBlockSize, bool zeroLatency, bool trueStereo)
+    {
+        const int headSize = ConvolutionEngine::getHeadSizeForBlockSize(maxBlockSize, zeroLatency);
+        const int numChannels = trueStereo ? NUM_TRUE_STEREO_CHANNELS : 1;
+
+        if (isPrepared &&
+            this->zeroLatency == zeroLatency &&
+            ConvolutionEngine::getHeadSizeForBlockSize(this->maxBlockSize, zeroLatency) == headSize &&
+            this->numChannels == numChannels)
+        {
+            return false;
+        }
+
+        this->maxBlockSize = maxBlockSize;
+        this->zeroLatency = zeroLatency;
+        this->numChannels = numChannels;
+        isPrepared = true;
+
+        pendingEngine.reset();
+
+        publishEngine(createEngine());
+        collectRetiredEngines();
+
+        return true;
+    }
+
+    /**
+    * @brief Partitions the IR and publishes a new engine holding its spectra.
+    *
+    * @details The new engine is fully built on the calling thread, then swapped in
+    *          atomically: the audio thread picks it up on its next exec() without ever
+    *          waiting. Prepares from the processor's block size if prepare() was never
+    *          called. In true-stereo mode, the IR must have getNumIRChannels()
+    *          channels, ordered L->L, L->R, R->L, R->R.
+    *
+    *          Must not be called from the audio thread.
     *
     * @param [in] ir    The IR signal to convolve with the audio buffer.
+    *
+    * @throws std::invalid_argument
     */
     void Convolution::loadIR(AudioBlock ir)
     {
-        juce::dsp::ProcessSpec spec;
-        spec.sampleRate = processor->getSampleRate();
-
-        // If the block size is small, the overlap-add method requires a small amount of RAM
-        // at the expense of increasing computational load. If the block size is large, the
-        // overlap-add method is more efficient computationally, at the expense of the memory
-        // required. It is relatively difficult to find an optimal block size, since the
-        // implementation is machine-dependent.
-        // https://books.google.ca/books?id=VQs_Ly4DYDMC&pg=PA130&lpg=PA130&dq=convolution+algorithm+optimal+block+size&source=bl&ots=jImfjKud-t&sig=SjLhgdAnfac0_6He7RBl0O-Snu8&hl=en&sa=X&ved=0ahUKEwj4y9367IDZAhWL24MKHV28AXoQ6AEIOzAD#v=onepage&q=convolution%20algorithm%20optimal%20block%20size&f=false
-        spec.maximumBlockSize = 2048;
-        spec.numChannels = (juce::uint32)ir.getNumChannels();
-
-        // Must be called before loading the impulse response to provide to the convolution
-        // the maximumBufferSize to handle and the sample rate for optional resampling.
-        prepare(spec);
-
-        copyAndLoadImpulseResponseFromBlock(ir, spec.sampleRate,
-                                            ir.getNumChannels() == 2,
-                                            false, false, 0);
+        buildIR(ir);
+        publishIR();
+
+        collectRetiredEngines();
+    }
+
+    /**
+    * @brief Partitions the IR and builds a new engine holding its spectra, without
+    *        publishing it
+    *
+    * @details Same as loadIR(), except the engine only replaces the current one on the
+    *          next publishIR() call. Convolutions are independent, so several of them
+    *          can build engines concurrently.
+    *
+    *          Must not be called from the audio thread.
+    *
+    * @param [in] ir    The IR signal to convolve with the audio buffer.
+    *
+    * @throws std::invalid_argument
+    */
+    void Convolution::buildIR(AudioBlock ir)
+    {
+        if (!isPrepared)
+        {
+            prepare(processor->getBlockSize());
+        }
+
+        const int numIRChannels = getNumIRChannels();
+
+        if ((int)ir.getNumChannels() < numIRChannels)
+        {
+            throw std::invalid_argument("Convolution requires an IR with " +
+                                        std::to_string(numIRChannels) + " channels");
+        }
+
+        std::vector<const float*> irChannels((size_t)numIRChannels);
+
+        for (int i = 0; i < numIRChannels; ++i)
+        {
+            irChannels[i] = ir.getChannelPointer(i);
+        }
+
+        pendingEngine = createEngine();
+        pendingEngine->loadIR(irChannels.data(), (int)ir.getNumSamples());
+    }
+
+    /**
+    * @brief Publishes the engine built by buildIR(), if any
+    *
+    * @details Only swaps pointers: replaced engines are freed by a later
+    *          collectRetiredEngines() call, so this is cheap enough to be called while
+    *          holding a lock the audio thread may wait for.
+    *
+    *          Must not be called from the audio thread.
+    *
+    * @returns True if an engine was published
+    */
+    bool Convolution::publishIR()
+    {
+        if (pendingEngine == nullptr)
+        {
+            return false;
+        }
+
+        publishEngine(std::move(pendingEngine));
+
+        return true;
+    }
+
+    /**
+    * @brief Returns the delay (in samples) introduced by the convolution
+    */
+    int Convolution::getLatencySamples() const
+    {
+        if (!isPrepared || zeroLatency)
+        {
+            return 0;
+        }
+
+        return ConvolutionEngine::getHeadSizeForBlockSize(maxBlockSize, zeroLatency);
+    }
+
+    /**
+    * @brief Returns the number of IR channels expected by loadIR()
+    */
+    int Convolution::getNumIRChannels() const
+    {
+        return numChannels * numChannels;
+    }
+
+    /**
+    * @brief Sets the length of the crossfade between the previous and new IR
+    *
+    * @details Takes effect on the next IR change. A length of 0 switches IRs
+    *          immediately.
+    *
+    * @param [in] numSamples    Crossfade length in samples
+    */
+    void Convolution::setCrossfadeLength(int numSamples)
+    {
+        crossfadeLength.store(std::max(numSamples, 0), std::memory_order_relaxed);
+    }
+
+    /**
+    * @brief Returns the total number of samples processed while crossfading
+    *
+    * @details During those samples, two engines were running.
+    */
+    int64_t Convolution::getNumCrossfadeSamples() const
+    {
+        return numCrossfadeSamples.load(std::memory_order_relaxed);
+    }
+
+    //==============================================================================
+    /**
+    * @brief Creates an empty engine with the current configuration
+    */
+    std::unique_ptr<ConvolutionEngine> Convolution::createEngine() const
+    {
+        std::unique_ptr<ConvolutionEngine> engine(new ConvolutionEngine());
+        engine->prepare(maxBlockSize, zeroLatency, numChannels, numChannels);
+
+        return engine;
+    }
+
+    /**
+    * @brief Makes an engine visible to exec() and retires the previous one
+    *
+    * @details The previous engine is tagged with the exec epoch seen right after the
+    *          swap. If it was even, exec() was not running and will pick up the new
+    *          engine next time; if it was odd, exec() may still be using the old
+    *          engine until the epoch moves on.
+    *
+    * @param [in] engine    Fully built engine to publish
+    */
+    void Convolution::publishEngine(std::unique_ptr<ConvolutionEngine> engine)
+    {
+        ConvolutionEngine* previousEngine = activeEngine.exchange(engine.release());
+
+        if (previousEngine != nullptr)
+        {
+            RetiredEngine retired;
+            retired.engine.reset(previousEngine);
+            retired.epoch = execEpoch.load();
+
+            retiredEngines.push_back(std::move(retired));
+        }
+    }
+
+    /**
+    * @brief Frees retired engines that exec() can no longer be using
+    *
+    * @details A retired engine is unused once the exec() call that may have picked it
+    *          up has returned, and it is neither the current nor the fading engine.
+    *          Must not be called from the audio thread, nor concurrently with
+    *          prepare() or loadIR().
+    */
+    void Convolution::collectRetiredEngines()
+    {
+        const uint32_t epoch = execEpoch.load(std::memory_order_acquire);
+
+        ConvolutionEngine* const current = currentEngineInUse.load();
+        ConvolutionEngine* const fading = fadingEngineInUse.load();
+
+        auto isUnused = [epoch, current, fading](const RetiredEngine& retired)
+        {
+            const bool pickedUp = (retired.epoch % 2 == 1) && (retired.epoch == epoch);
+            const bool inUse = (retired.engine.get() == current) ||
+                               (retired.engine.get() == fading);
+
+            return !pickedUp && !inUse;
+        };
+
+        retiredEngines.erase(std::remove_if(retiredEngines.begin(), retiredEngines.end(), isUnused),
+                             retiredEngines.end());
     }
 }
\ No newline at end of file
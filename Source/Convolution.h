@@ -10,20 +10,42 @@ Convolution.h
 
 #include "Task.h"
 
+#include "ConvolutionEngine.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 namespace reverb
 {
 
 	//==============================================================================
 	/**
-	 * Derives from JUCE's Convolution base class. Computes the convolution
-	 * algorithm between the audio signal and the IR buffer.
+	 * Computes the convolution between the audio signal and the IR buffer using a
+	 * non-uniform partitioned ConvolutionEngine.
+	 *
+	 * In true-stereo mode, a stereo signal is convolved with a 4-channel IR
+	 * (L->L, L->R, R->L, R->R) and each output mixes the contributions of both inputs.
+	 *
+	 * Engines are built off the audio thread and handed to exec() through an atomic
+	 * pointer. Replaced engines are freed once exec() is known to be done with them
+	 * (epoch-based reclamation), so exec() never waits for an IR change.
+	 *
+	 * When exec() picks up a new engine, it keeps running the previous one alongside
+	 * for the crossfade length and fades from one to the other, so IR changes don't
+	 * click. Both engines only run during the transition.
+	 *
+	 * Building and publishing an engine can be done in two steps (buildIR(), then
+	 * publishIR()), so that several convolutions can build their engines in parallel and
+	 * swap them in together.
 	 */
-	class Convolution : public Task,
-		                protected juce::dsp::Convolution
+	class Convolution : public Task
 	{
 	public:
 		//==============================================================================
 		Convolution(juce::AudioProcessor* processor);
+		~Convolution();
 
 		//==============================================================================
 		using Ptr = std::shared_ptr<Convolution>;
@@ -35,7 +57,73 @@ namespace reverb
         virtual AudioBlock exec(AudioBlock audio) override;
 
 		//==============================================================================
+		bool prepare(int maxBlockSize, bool zeroLatency = false, bool trueStereo = false);
 		void loadIR(AudioBlock ir);
+
+		void buildIR(AudioBlock ir);
+		bool publishIR();
+
+		int getLatencySamples() const;
+		int getNumIRChannels() const;
+
+		void setCrossfadeLength(int numSamples);
+		int64_t getNumCrossfadeSamples() const;
+
+		void collectRetiredEngines();
+
+		static constexpr int NUM_TRUE_STEREO_CHANNELS = 2;
+		static constexpr int CROSSFADE_BUFFER_SIZE = 1024;
+
+	protected:
+		//==============================================================================
+		std::unique_ptr<ConvolutionEngine> createEngine() const;
+		void publishEngine(std::unique_ptr<ConvolutionEngine> engine);
+
+		void processEngine(ConvolutionEngine* engine, AudioBlock audio);
+		void processCrossfade(AudioBlock audio);
+
+		//==============================================================================
+		// Engine configuration
+		bool isPrepared = false;
+		int maxBlockSize = 0;
+		bool zeroLatency = false;
+		int numChannels = 1;
+
+		//==============================================================================
+		// Engine built but not published yet (see publishIR())
+		std::unique_ptr<ConvolutionEngine> pendingEngine;
+
+		//==============================================================================
+		// Engine currently used by exec() (owned)
+		std::atomic<ConvolutionEngine*> activeEngine { nullptr };
+
+		// Incremented when exec() starts and ends (i.e. odd while it is running)
+		std::atomic<uint32_t> execEpoch { 0 };
+
+		// Engines still held by exec() between calls (hazard pointers)
+		std::atomic<ConvolutionEngine*> currentEngineInUse { nullptr };
+		std::atomic<ConvolutionEngine*> fadingEngineInUse { nullptr };
+
+		struct RetiredEngine
+		{
+			std::unique_ptr<ConvolutionEngine> engine;
+			uint32_t epoch = 0;
+		};
+
+		std::vector<RetiredEngine> retiredEngines;
+
+		//==============================================================================
+		// Crossfade state (audio thread only)
+		ConvolutionEngine* currentEngine = nullptr;
+		ConvolutionEngine* fadingEngine = nullptr;
+
+		int fadePosition = 0;
+		int fadeLength = 0;
+
+		juce::AudioSampleBuffer fadeBuffer;
+
+		std::atomic<int> crossfadeLength { 0 };
+		std::atomic<int64_t> numCrossfadeSamples { 0 };
 	};
 
 }
\ No newline at end of file
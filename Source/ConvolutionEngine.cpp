@@ -0,0 +1,503 @@
+/*
+  ==============================================================================
+
+    ConvolutionEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "ConvolutionEngine.h"
+
+#include "ComplexMAC.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * Ring buffer helpers (ring size must be a power of two)
+     */
+    static void copyFromRing(float* dst, const float* ring, int ringSize, int start, int numSamples)
+    {
+        start &= ringSize - 1;
+        const int n1 = std::min(numSamples, ringSize - start);
+
+        juce::FloatVectorOperations::copy(dst, ring + start, n1);
+        juce::FloatVectorOperations::copy(dst + n1, ring, numSamples - n1);
+    }
+
+    static void copyToRing(float* ring, int ringSize, int start, const float* src, int numSamples)
+    {
+        start &= ringSize - 1;
+        const int n1 = std::min(numSamples, ringSize - start);
+
+        juce::FloatVectorOperations::copy(ring + start, src, n1);
+        juce::FloatVectorOperations::copy(ring, src + n1, numSamples - n1);
+    }
+
+    static void addToRing(float* ring, int ringSize, int start, const float* src, int numSamples)
+    {
+        start &= ringSize - 1;
+        const int n1 = std::min(numSamples, ringSize - start);
+
+        juce::FloatVectorOperations::add(ring + start, src, n1);
+        juce::FloatVectorOperations::add(ring, src + n1, numSamples - n1);
+    }
+
+    static void clearRing(float* ring, int ringSize, int start, int numSamples)
+    {
+        start &= ringSize - 1;
+        const int n1 = std::min(numSamples, ringSize - start);
+
+        juce::FloatVectorOperations::clear(ring + start, n1);
+        juce::FloatVectorOperations::clear(ring, numSamples - n1);
+    }
+
+    //==============================================================================
+    /**
+     * @brief Returns the head partition size used for a given host block size
+     *
+     * The head partition size is the smallest power of two that holds a full host block,
+     * clamped to [MIN_HEAD_SIZE, MAX_HEAD_SIZE]. It is also the engine latency, unless in
+     * zero-latency mode, where it is the FIR length and is further capped to
+     * MAX_FIR_HEAD_SIZE to bound the time-domain cost per sample.
+     *
+     * @param [in] blockSize    Maximum expected host block size
+     * @param [in] zeroLatency  True if the head is handled by a direct-form FIR
+     */
+    int ConvolutionEngine::getHeadSizeForBlockSize(int blockSize, bool zeroLatency)
+    {
+        const int headSize = juce::jlimit(MIN_HEAD_SIZE, MAX_HEAD_SIZE,
+                                          juce::nextPowerOfTwo(std::max(blockSize, 1)));
+
+        return zeroLatency ? std::min(headSize, MAX_FIR_HEAD_SIZE) : headSize;
+    }
+
+    //==============================================================================
+    /**
+     * @brief Sets up the engine for a given maximum host block size and channel layout
+     *
+     * Picks the head partition size (and thus the latency). Any previously loaded IR
+     * is discarded since its partitioning depends on the head size.
+     *
+     * @param [in] maxBlockSize Maximum expected host block size
+     * @param [in] zeroLatency  True to run the IR head as a direct-form FIR
+     * @param [in] numInputs    Number of input channels
+     * @param [in] numOutputs   Number of output channels
+     */
+    void ConvolutionEngine::prepare(int maxBlockSize, bool zeroLatency,
+                                    int numInputs, int numOutputs)
+    {
+        jassert(numInputs > 0 && numOutputs > 0);
+
+        this->zeroLatency = zeroLatency;
+        this->numInputs = numInputs;
+        this->numOutputs = numOutputs;
+
+        headSize = getHeadSizeForBlockSize(maxBlockSize, zeroLatency);
+
+        inputFifo.assign((size_t)numInputs * headSize, 0.0f);
+        outputFifo.assign((size_t)numOutputs * headSize, 0.0f);
+
+        firCoeffs.assign(zeroLatency ? (size_t)numInputs * numOutputs * headSize : 0, 0.0f);
+        firFrame.assign(zeroLatency ? (size_t)numInputs * (2 * headSize - 1) : 0, 0.0f);
+
+        buildStages(0);
+    }
+
+    /**
+     * @brief Clears all audio history without unloading the IR
+     */
+    void ConvolutionEngine::reset()
+    {
+        std::fill(history.begin(), history.end(), 0.0f);
+        std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+        std::fill(inputFifo.begin(), inputFifo.end(), 0.0f);
+        std::fill(outputFifo.begin(), outputFifo.end(), 0.0f);
+        std::fill(firFrame.begin(), firFrame.end(), 0.0f);
+
+        for (auto& stage : stages)
+        {
+            std::fill(stage.fdlRe.begin(), stage.fdlRe.end(), 0.0f);
+            std::fill(stage.fdlIm.begin(), stage.fdlIm.end(), 0.0f);
+            stage.fdlPos = 0;
+        }
+
+        historyPos = 0;
+        accumulatorPos = 0;
+        fifoPos = 0;
+        numTicks = 0;
+    }
+
+    //==============================================================================
+    /**
+     * @brief Partitions the IRs into stages and computes the spectrum of every partition
+     *
+     * Stage k uses partitions of (headSize * 2^k) samples, up to MAX_PARTITION_SIZE. Every
+     * stage holds PARTITIONS_PER_STAGE partitions except the last one, which holds whatever
+     * remains of the IR. With at least two partitions per stage, each stage's output is
+     * always written ahead of the samples currently being read out.
+     *
+     * In zero-latency mode, the first head partition goes to the FIR and the stages are
+     * built from the remainder of the IR.
+     *
+     * Allocates memory: must not be called from the audio thread.
+     *
+     * @param [in] irs          One IR per path, ordered input-major (i.e. for 2x2:
+     *                          L->L, L->R, R->L, R->R), all of the same length
+     * @param [in] numSamples   Number of samples in each IR
+     */
+    void ConvolutionEngine::loadIR(const float* const* irs, int numSamples)
+    {
+        jassert(isPrepared());
+
+        const int numPaths = numInputs * numOutputs;
+        int offsetInIR = 0;
+
+        if (zeroLatency)
+        {
+            const int numTaps = std::min(headSize, numSamples);
+
+            std::fill(firCoeffs.begin(), firCoeffs.end(), 0.0f);
+
+            for (int path = 0; path < numPaths; ++path)
+            {
+                std::copy(irs[path], irs[path] + numTaps, firCoeffs.begin() + path * headSize);
+            }
+
+            offsetInIR = numTaps;
+        }
+
+        const int tailNumSamples = numSamples - offsetInIR;
+
+        buildStages(tailNumSamples);
+
+        for (auto& stage : stages)
+        {
+            const int N = stage.partitionSize;
+            float* buffer = stage.fftBuffer.data();
+
+            for (int path = 0; path < numPaths; ++path)
+            {
+                for (int p = 0; p < stage.numPartitions; ++p)
+                {
+                    const int start = stage.offset + p * N;
+                    const int length = std::min(N, tailNumSamples - start);
+
+                    std::fill(stage.fftBuffer.begin(), stage.fftBuffer.end(), 0.0f);
+                    juce::FloatVectorOperations::copy(buffer, irs[path] + offsetInIR + start, length);
+
+                    stage.fft->performRealOnlyForwardTransform(buffer, true);
+
+                    const size_t row = ((size_t)path * stage.numPartitions + p) * stage.binStride;
+                    float* re = stage.irRe.data() + row;
+                    float* im = stage.irIm.data() + row;
+
+                    for (int k = 0; k < stage.numBins; ++k)
+                    {
+                        re[k] = buffer[2 * k];
+                        im[k] = buffer[2 * k + 1];
+                    }
+                }
+            }
+        }
+
+        reset();
+    }
+
+    /**
+     * @brief Lays out stages for an IR of given length and allocates their buffers
+     *
+     * @param [in] irNumSamples Number of IR samples handled by the partitioned stages
+     */
+    void ConvolutionEngine::buildStages(int irNumSamples)
+    {
+        stages.clear();
+
+        const int numPaths = numInputs * numOutputs;
+
+        int offset = 0;
+        int partitionSize = headSize;
+        int maxPartitionSize = headSize;
+
+        while (offset < irNumSamples)
+        {
+            const bool isLastSize = (partitionSize >= MAX_PARTITION_SIZE);
+            const int remaining = irNumSamples - offset;
+            const int partitionsNeeded = (remaining + partitionSize - 1) / partitionSize;
+
+            stages.emplace_back();
+            Stage& stage = stages.back();
+
+            stage.partitionSize = partitionSize;
+            stage.offset = offset;
+            stage.numPartitions = isLastSize ? partitionsNeeded
+                                             : std::min(partitionsNeeded, PARTITIONS_PER_STAGE);
+
+            // Real FFT of size 2N yields N + 1 bins; pad rows for vectorised access
+            stage.numBins = partitionSize + 1;
+            stage.binStride = (stage.numBins + 7) & ~7;
+
+            stage.fft.reset(new juce::dsp::FFT(juce::roundToInt(std::log2(2 * partitionSize))));
+
+            const size_t rowsSize = (size_t)stage.numPartitions * stage.binStride;
+            stage.irRe.assign(numPaths * rowsSize, 0.0f);
+            stage.irIm.assign(numPaths * rowsSize, 0.0f);
+            stage.fdlRe.assign(numInputs * rowsSize, 0.0f);
+            stage.fdlIm.assign(numInputs * rowsSize, 0.0f);
+            stage.accRe.assign(stage.binStride, 0.0f);
+            stage.accIm.assign(stage.binStride, 0.0f);
+            stage.fftBuffer.assign(4 * partitionSize, 0.0f);
+
+            maxPartitionSize = std::max(maxPartitionSize, partitionSize);
+            offset += stage.numPartitions * partitionSize;
+
+            if (!isLastSize)
+            {
+                partitionSize *= 2;
+            }
+        }
+
+        // Overlap-save frames span two partitions of the largest stage
+        historySize = juce::nextPowerOfTwo(2 * maxPartitionSize);
+        history.assign((size_t)numInputs * historySize, 0.0f);
+
+        // Stage outputs are written up to (offset) samples ahead of the read position
+        int maxOffset = 0;
+
+        for (const auto& stage : stages)
+        {
+            maxOffset = std::max(maxOffset, stage.offset);
+        }
+
+        accumulatorSize = juce::nextPowerOfTwo(maxOffset + 2 * headSize);
+        accumulator.assign((size_t)numOutputs * accumulatorSize, 0.0f);
+    }
+
+    //==============================================================================
+    /**
+     * @brief Convolves a block of samples with the loaded IRs
+     *
+     * Input is buffered into head-sized chunks, so the partitioned output is delayed by
+     * exactly one head partition. In zero-latency mode, the FIR head is added on top of
+     * it without delay. Does not allocate; input and output channels may alias.
+     *
+     * @param [in]  in          Input channels (numInputs)
+     * @param [out] out         Output channels (numOutputs)
+     * @param [in]  numSamples  Number of samples to process
+     */
+    void ConvolutionEngine::process(const float* const* in, float* const* out, int numSamples)
+    {
+        jassert(isPrepared());
+
+        const int firFrameSize = 2 * headSize - 1;
+        int done = 0;
+
+        while (done < numSamples)
+        {
+            const int n = std::min(numSamples - done, headSize - fifoPos);
+
+            // Consume all inputs before writing any output, in case they alias
+            for (int i = 0; i < numInputs; ++i)
+            {
+                juce::FloatVectorOperations::copy(inputFifo.data() + i * headSize + fifoPos,
+                                                  in[i] + done, n);
+
+                if (zeroLatency)
+                {
+                    juce::FloatVectorOperations::copy(firFrame.data() + i * firFrameSize + headSize - 1,
+                                                      in[i] + done, n);
+                }
+            }
+
+            for (int o = 0; o < numOutputs; ++o)
+            {
+                juce::FloatVectorOperations::copy(out[o] + done,
+                                                  outputFifo.data() + o * headSize + fifoPos, n);
+            }
+
+            if (zeroLatency)
+            {
+                processFIR(out, done, n);
+            }
+
+            fifoPos += n;
+            done += n;
+
+            if (fifoPos == headSize)
+            {
+                tick();
+                fifoPos = 0;
+            }
+        }
+    }
+
+    /**
+     * @brief Adds the FIR heads' output for the chunk staged in firFrame
+     *
+     * Each input's firFrame holds its previous (headSize - 1) samples followed by the
+     * current chunk. Each tap is applied as one vectorised multiply-add over the whole
+     * chunk. Afterwards, the last (headSize - 1) samples are kept as history for the next
+     * chunk.
+     *
+     * @param [in,out] out          Output channels to add to
+     * @param [in]     outOffset    Position of the chunk in the output channels
+     * @param [in]     numSamples   Chunk length (at most headSize)
+     */
+    void ConvolutionEngine::processFIR(float* const* out, int outOffset, int numSamples)
+    {
+        const int historyLength = headSize - 1;
+        const int firFrameSize = 2 * headSize - 1;
+
+        for (int i = 0; i < numInputs; ++i)
+        {
+            float* inputFrame = firFrame.data() + i * firFrameSize;
+            const float* frame = inputFrame + historyLength;
+
+            for (int o = 0; o < numOutputs; ++o)
+            {
+                const float* coeffs = firCoeffs.data() + (i * numOutputs + o) * headSize;
+
+                for (int j = 0; j < headSize; ++j)
+                {
+                    juce::FloatVectorOperations::addWithMultiply(out[o] + outOffset, frame - j,
+                                                                 coeffs[j], numSamples);
+                }
+            }
+
+            // NB: Use memmove since source and destination overlap for short chunks
+            memmove(inputFrame, inputFrame + numSamples, historyLength * sizeof(float));
+        }
+    }
+
+    /**
+     * @brief Consumes one head-sized chunk of input and produces one chunk of output
+     *
+     * Runs every stage whose partition size divides the number of samples received so
+     * far, then reads the completed output chunk out of the accumulators.
+     */
+    void ConvolutionEngine::tick()
+    {
+        // Append input to history
+        for (int i = 0; i < numInputs; ++i)
+        {
+            copyToRing(history.data() + (size_t)i * historySize, historySize, historyPos,
+                       inputFifo.data() + i * headSize, headSize);
+        }
+
+        historyPos = (historyPos + headSize) & (historySize - 1);
+        accumulatorPos = (accumulatorPos + headSize) & (accumulatorSize - 1);
+        ++numTicks;
+
+        for (auto& stage : stages)
+        {
+            if (numTicks % (stage.partitionSize / headSize) == 0)
+            {
+                processStage(stage);
+            }
+        }
+
+        // Read out finished samples
+        const int readPos = accumulatorPos - headSize;
+
+        for (int o = 0; o < numOutputs; ++o)
+        {
+            float* ring = accumulator.data() + (size_t)o * accumulatorSize;
+
+            copyFromRing(outputFifo.data() + o * headSize, ring, accumulatorSize, readPos, headSize);
+            clearRing(ring, accumulatorSize, readPos, headSize);
+        }
+    }
+
+    /**
+     * @brief Runs one overlap-save step of a stage
+     *
+     * Transforms the last 2N samples of each input and pushes the spectra into the
+     * stage's FDL. Then, for each output, multiplies and accumulates every input's FDL
+     * against the matching IR partitions, and adds the N valid output samples to the
+     * output's accumulator at the stage's offset.
+     *
+     * @param [in,out] stage    Stage to process
+     */
+    void ConvolutionEngine::processStage(Stage& stage)
+    {
+        const int N = stage.partitionSize;
+        const int fftSize = 2 * N;
+        const size_t rowsSize = (size_t)stage.numPartitions * stage.binStride;
+        float* buffer = stage.fftBuffer.data();
+
+        // Advance FDL (newest at fdlPos)
+        stage.fdlPos = (stage.fdlPos == 0) ? stage.numPartitions - 1 : stage.fdlPos - 1;
+
+        // Forward transform: once per input, shared by all outputs
+        for (int i = 0; i < numInputs; ++i)
+        {
+            copyFromRing(buffer, history.data() + (size_t)i * historySize, historySize,
+                         historyPos - fftSize, fftSize);
+            juce::FloatVectorOperations::clear(buffer + fftSize, fftSize);
+
+            stage.fft->performRealOnlyForwardTransform(buffer, true);
+
+            const size_t row = i * rowsSize + (size_t)stage.fdlPos * stage.binStride;
+            float* xRe = stage.fdlRe.data() + row;
+            float* xIm = stage.fdlIm.data() + row;
+
+            for (int k = 0; k < stage.numBins; ++k)
+            {
+                xRe[k] = buffer[2 * k];
+                xIm[k] = buffer[2 * k + 1];
+            }
+        }
+
+        float* accRe = stage.accRe.data();
+        float* accIm = stage.accIm.data();
+
+        for (int o = 0; o < numOutputs; ++o)
+        {
+            // Complex multiply-accumulate over all inputs and partitions
+            juce::FloatVectorOperations::clear(accRe, stage.binStride);
+            juce::FloatVectorOperations::clear(accIm, stage.binStride);
+
+            for (int i = 0; i < numInputs; ++i)
+            {
+                const size_t irRows = (size_t)(i * numOutputs + o) * rowsSize;
+
+                for (int p = 0; p < stage.numPartitions; ++p)
+                {
+                    const int slot = (stage.fdlPos + p) % stage.numPartitions;
+
+                    const float* aRe = stage.fdlRe.data() + i * rowsSize + (size_t)slot * stage.binStride;
+                    const float* aIm = stage.fdlIm.data() + i * rowsSize + (size_t)slot * stage.binStride;
+                    const float* bRe = stage.irRe.data() + irRows + (size_t)p * stage.binStride;
+                    const float* bIm = stage.irIm.data() + irRows + (size_t)p * stage.binStride;
+
+                    // Rows are padded to binStride with zeros, so process whole vectors
+                    ComplexMAC::process(accRe, accIm, aRe, aIm, bRe, bIm, stage.binStride);
+                }
+            }
+
+            // Rebuild full conjugate-symmetric spectrum and transform back
+            for (int k = 0; k < stage.numBins; ++k)
+            {
+                buffer[2 * k] = accRe[k];
+                buffer[2 * k + 1] = accIm[k];
+            }
+
+            for (int k = stage.numBins; k < fftSize; ++k)
+            {
+                buffer[2 * k] = accRe[fftSize - k];
+                buffer[2 * k + 1] = -accIm[fftSize - k];
+            }
+
+            stage.fft->performRealOnlyInverseTransform(buffer);
+
+            // Last N samples of the frame are valid; they belong at [t - N + offset, t + offset)
+            addToRing(accumulator.data() + (size_t)o * accumulatorSize, accumulatorSize,
+                      accumulatorPos - N + stage.offset, buffer + N, N);
+        }
+    }
+
+}
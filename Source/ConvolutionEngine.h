@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+
+    ConvolutionEngine.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#include <memory>
+#include <vector>
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * Non-uniform partitioned convolution engine (overlap-save).
+     *
+     * The impulse response is split into stages whose partition sizes grow geometrically:
+     * the head of the IR is convolved with small partitions, which sets the engine latency
+     * (one head partition), while the tail uses large partitions, which need far fewer FFTs
+     * per sample. Each stage runs a frequency-domain delay line (FDL) of input spectra and
+     * adds its output into a shared accumulation ring buffer, ahead of the read position.
+     *
+     * In zero-latency mode, the first head partition of the IR is instead applied as a
+     * direct-form FIR filter, and the partitioned stages convolve the rest of the IR. The
+     * partitioned path's one-partition delay then lines up exactly with the FIR's length.
+     *
+     * The engine convolves a matrix of inputs and outputs (e.g. 2x2 for true-stereo IRs),
+     * with one IR per input/output path. Each input is transformed once per partition and
+     * its spectrum is shared by every output, so only the multiply-accumulate work grows
+     * with the number of paths.
+     */
+    class ConvolutionEngine
+    {
+    public:
+        //==============================================================================
+        ConvolutionEngine() = default;
+
+        ConvolutionEngine(const ConvolutionEngine&) = delete;
+        ConvolutionEngine& operator=(const ConvolutionEngine&) = delete;
+
+        //==============================================================================
+        void prepare(int maxBlockSize, bool zeroLatency = false,
+                     int numInputs = 1, int numOutputs = 1);
+        void reset();
+
+        void loadIR(const float* const* irs, int numSamples);
+        void loadIR(const float* ir, int numSamples) { loadIR(&ir, numSamples); }
+
+        void process(const float* const* in, float* const* out, int numSamples);
+        void process(const float* in, float* out, int numSamples) { process(&in, &out, numSamples); }
+
+        //==============================================================================
+        bool isPrepared() const { return headSize > 0; }
+        bool isZeroLatency() const { return zeroLatency; }
+
+        int getHeadSize() const { return headSize; }
+        int getLatencySamples() const { return zeroLatency ? 0 : headSize; }
+
+        int getNumInputs() const { return numInputs; }
+        int getNumOutputs() const { return numOutputs; }
+
+        static int getHeadSizeForBlockSize(int blockSize, bool zeroLatency = false);
+
+        //==============================================================================
+        static constexpr int MIN_HEAD_SIZE = 64;
+        static constexpr int MAX_HEAD_SIZE = 1024;
+        static constexpr int MAX_FIR_HEAD_SIZE = 256;
+        static constexpr int MAX_PARTITION_SIZE = 8192;
+        static constexpr int PARTITIONS_PER_STAGE = 4;
+
+    protected:
+        //==============================================================================
+        /**
+         * Uniformly partitioned segment of the IR, convolved using FFTs of twice the
+         * partition size. Spectra are stored in split real/imaginary form, one row of
+         * binStride floats per partition, grouped by path (IR) or input (FDL).
+         */
+        struct Stage
+        {
+            int partitionSize = 0;
+            int offset = 0;
+            int numPartitions = 0;
+            int numBins = 0;
+            int binStride = 0;
+
+            std::unique_ptr<juce::dsp::FFT> fft;
+
+            std::vector<float> irRe, irIm;
+            std::vector<float> fdlRe, fdlIm;
+            std::vector<float> accRe, accIm;
+            std::vector<float> fftBuffer;
+
+            int fdlPos = 0;
+        };
+
+        //==============================================================================
+        void buildStages(int irNumSamples);
+        void processStage(Stage& stage);
+        void tick();
+        void processFIR(float* const* out, int outOffset, int numSamples);
+
+        //==============================================================================
+        int headSize = 0;
+        int numInputs = 1;
+        int numOutputs = 1;
+
+        std::vector<Stage> stages;
+
+        // Time-domain input history (one ring buffer per input) used to build
+        // overlap-save frames
+        std::vector<float> history;
+        int historySize = 0;
+        int historyPos = 0;
+
+        // Output accumulation ring buffers (one per output)
+        std::vector<float> accumulator;
+        int accumulatorSize = 0;
+        int accumulatorPos = 0;
+
+        // Head-sized FIFOs between host blocks and engine ticks
+        std::vector<float> inputFifo, outputFifo;
+        int fifoPos = 0;
+
+        int64_t numTicks = 0;
+
+        // Zero-latency mode: direct-form FIR over the first head partition of each IR
+        bool zeroLatency = false;
+
+        std::vector<float> firCoeffs;
+        std::vector<float> firFrame;
+    };
+
+}
@@ -9,14 +9,168 @@ Equalizer.cpp
 #include "Equalizer.h"
 #include "PluginProcessor.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define REVERB_EQ_SSE2 1
+#endif
+
 namespace reverb {
 
+    //==============================================================================
+    /**
+    * Coefficients of a cascade of biquads, one lane per band. Bands are packed at the end
+    * of the lanes; lanes before them hold pass-through biquads (b0 = 1).
+    */
+    struct BiquadCascade
+    {
+        static constexpr int NUM_LANES = 8;
+        static constexpr int LANES_PER_VECTOR = 4;
+
+        alignas(16) float b0[NUM_LANES];
+        alignas(16) float b1[NUM_LANES];
+        alignas(16) float b2[NUM_LANES];
+        alignas(16) float a1[NUM_LANES];
+        alignas(16) float a2[NUM_LANES];
+
+        int numVectors;
+        int firstBand;
+    };
+
+#if REVERB_EQ_SSE2
+    /**
+    * @brief Runs samples through all bands of a cascade in place, in a single pass
+    *
+    * Bands depend on each other within a sample, but not across samples: at step n, lane k
+    * filters sample (n - k), using the output of lane (k - 1) from step (n - 1). All bands
+    * thus run side by side in SIMD lanes, and the cascade's output comes out of the last
+    * lane (4 * numVectors - 1) steps later.
+    */
+    template <int numVectors>
+    static void processCascadeSSE2(const BiquadCascade& cascade, float* samples, int numSamples)
+    {
+        constexpr int latency = numVectors * BiquadCascade::LANES_PER_VECTOR - 1;
+
+        __m128 b0[numVectors], b1[numVectors], b2[numVectors], a1[numVectors], a2[numVectors];
+        __m128 s1[numVectors], s2[numVectors], y[numVectors], in[numVectors];
+
+        for (int v = 0; v < numVectors; ++v)
+        {
+            const int lane = v * BiquadCascade::LANES_PER_VECTOR;
+
+            b0[v] = _mm_load_ps(cascade.b0 + lane);
+            b1[v] = _mm_load_ps(cascade.b1 + lane);
+            b2[v] = _mm_load_ps(cascade.b2 + lane);
+            a1[v] = _mm_load_ps(cascade.a1 + lane);
+            a2[v] = _mm_load_ps(cascade.a2 + lane);
+
+            s1[v] = _mm_setzero_ps();
+            s2[v] = _mm_setzero_ps();
+            y[v] = _mm_setzero_ps();
+        }
+
+        for (int n = 0; n < numSamples + latency; ++n)
+        {
+            const float x = (n < numSamples) ? samples[n] : 0.0f;
+
+            // Shift previous outputs up one lane, feeding the new sample into lane 0
+            for (int v = 0; v < numVectors; ++v)
+            {
+                const __m128 shifted = _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(y[v]), 4));
+                const __m128 carry = (v == 0) ? _mm_set_ss(x)
+                                              : _mm_shuffle_ps(y[v - 1], y[v - 1], _MM_SHUFFLE(3, 3, 3, 3));
+
+                in[v] = _mm_move_ss(shifted, carry);
+            }
+
+            for (int v = 0; v < numVectors; ++v)
+            {
+                y[v] = _mm_add_ps(_mm_mul_ps(b0[v], in[v]), s1[v]);
+
+                s1[v] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1[v], in[v]), _mm_mul_ps(a1[v], y[v])), s2[v]);
+                s2[v] = _mm_sub_ps(_mm_mul_ps(b2[v], in[v]), _mm_mul_ps(a2[v], y[v]));
+            }
+
+            if (n >= latency)
+            {
+                const __m128 last = y[numVectors - 1];
+                samples[n - latency] = _mm_cvtss_f32(_mm_shuffle_ps(last, last, _MM_SHUFFLE(3, 3, 3, 3)));
+            }
+        }
+    }
+#else
+    /**
+    * @brief Runs samples through all bands of a cascade in place, one band after the other
+    *
+    * Portable version of processCascadeSSE2().
+    */
+    static void processCascadeScalar(const BiquadCascade& cascade, float* samples, int numSamples)
+    {
+        const int numLanes = cascade.numVectors * BiquadCascade::LANES_PER_VECTOR;
+
+        float s1[BiquadCascade::NUM_LANES] = {};
+        float s2[BiquadCascade::NUM_LANES] = {};
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            float x = samples[n];
+
+            // Transposed direct form II, as juce::dsp::IIR::Filter
+            for (int k = cascade.firstBand; k < numLanes; ++k)
+            {
+                const float y = cascade.b0[k] * x + s1[k];
+
+                s1[k] = cascade.b1[k] * x - cascade.a1[k] * y + s2[k];
+                s2[k] = cascade.b2[k] * x - cascade.a2[k] * y;
+
+                x = y;
+            }
+
+            samples[n] = x;
+        }
+    }
+#endif
+
+    /**
+    * Cascade and IR shared by the jobs filtering each IR channel
+    */
+    struct CascadeJobs
+    {
+        const BiquadCascade* cascade;
+        AudioBlock* ir;
+
+        /**
+        * @brief Runs one IR channel through the cascade (worker pool job)
+        */
+        static void processChannel(void* context, int channel)
+        {
+            juce::ScopedNoDenormals noDenormals;
+
+            const auto jobs = static_cast<CascadeJobs*>(context);
+
+            float* samples = jobs->ir->getChannelPointer((size_t)channel);
+            const int numSamples = (int)jobs->ir->getNumSamples();
+
+#if REVERB_EQ_SSE2
+            if (jobs->cascade->numVectors == 1)
+            {
+                processCascadeSSE2<1>(*jobs->cascade, samples, numSamples);
+            }
+            else
+            {
+                processCascadeSSE2<2>(*jobs->cascade, samples, numSamples);
+            }
+#else
+            processCascadeScalar(*jobs->cascade, samples, numSamples);
+#endif
+        }
+    };
+
     Equalizer::Equalizer(juce::AudioProcessor * processor, int numFilters)
         : Task(processor) 
     {
 
-        if (numFilters < 3) numFilters = 3;
-        if (numFilters > 6) numFilters = 6;
+        if (numFilters < MIN_NUM_FILTERS) numFilters = MIN_NUM_FILTERS;
+        if (numFilters > MAX_NUM_FILTERS) numFilters = MAX_NUM_FILTERS;
 
         filterSet.add(new LowShelfFilter(processor));
         
@@ -100,15 +254,61 @@ namespace reverb {
     /**
     * @brief Processes the AudioBuffer input with the EQ filters
     *
+    * All filters run in a single pass over each channel, using the filters' cached
+    * coefficients. Each channel is filtered from silence (no state is kept between calls),
+    * on the worker pool if one is set.
+    *
     * @param [in] ir   AudioBuffer to be processed
     */
 
     AudioBlock Equalizer::exec(AudioBlock ir) 
     {
+        static_assert(MAX_NUM_FILTERS <= BiquadCascade::NUM_LANES, "Cascade cannot hold all filters");
 
-        for (int i = 0; i < filterSet.size(); i++) 
+        const int numFilters = filterSet.size();
+
+        BiquadCascade cascade;
+        cascade.numVectors = (numFilters + BiquadCascade::LANES_PER_VECTOR - 1) / BiquadCascade::LANES_PER_VECTOR;
+        cascade.firstBand = cascade.numVectors * BiquadCascade::LANES_PER_VECTOR - numFilters;
+
+        for (int k = 0; k < BiquadCascade::NUM_LANES; k++)
+        {
+            const int i = k - cascade.firstBand;
+
+            if (i < 0 || i >= numFilters)
+            {
+                // Pass-through
+                cascade.b0[k] = 1.0f;
+                cascade.b1[k] = cascade.b2[k] = cascade.a1[k] = cascade.a2[k] = 0.0f;
+                continue;
+            }
+
+            // All filters are 2nd order: b0, b1, b2, a1, a2 (a0 = 1)
+            const auto& coeffs = filterSet[i]->getCoefficients().coefficients;
+
+            cascade.b0[k] = coeffs[0];
+            cascade.b1[k] = coeffs[1];
+            cascade.b2[k] = coeffs[2];
+            cascade.a1[k] = coeffs[3];
+            cascade.a2[k] = coeffs[4];
+
+            filterSet[i]->mustExec = false;
+        }
+
+        // Channels are independent, so they are filtered in parallel if possible
+        CascadeJobs jobs = { &cascade, &ir };
+        const int numChannels = (int)ir.getNumChannels();
+
+        if (workerPool && numChannels > 1)
+        {
+            workerPool->run(numChannels, &CascadeJobs::processChannel, &jobs);
+        }
+        else
         {
-            filterSet[i]->exec(ir);
+            for (int ch = 0; ch < numChannels; ch++)
+            {
+                CascadeJobs::processChannel(&jobs, ch);
+            }
         }
 
         mustExec = false;
@@ -116,6 +316,20 @@ namespace reverb {
         return ir;
     }
 
+    /**
+    * @brief Sets the worker pool IR channels are filtered on
+    *
+    * The pool must outlive this object, or be unset first. Without a pool, channels are
+    * filtered one after the other.
+    *
+    * @param [in] pool Worker pool (may be null)
+    */
+
+    void Equalizer::setWorkerPool(WorkerPool* pool)
+    {
+        workerPool = pool;
+    }
+
     void Equalizer::updateSampleRate(double sr) {
         for (int i = 0; i < filterSet.size(); i++) {
             filterSet[i]->updateSampleRate(sr);
@@ -156,6 +370,11 @@ namespace reverb {
 
         evalFrequencies[(dim - 1)] = 21000;
 
+        //Tabulate evaluation frequencies once for all iterations
+
+        MagnitudeResponse response;
+        response.prepare(evalFrequencies.data(), dim, processor->getSampleRate());
+
         //Create Matrix objects
 
         juce::dsp::Matrix<float> B(dim, dim);
@@ -184,16 +403,8 @@ namespace reverb {
 
             memcpy(lambda_data, gamma_data, dim * sizeof(float));
 
-            //Compute B matrix with new gains
-            for (int i = 0; i < dim; i++)
-            {
-
-                for (int j = 0; j < dim; j++)
-                {
-
-                    B_data[j + B.getNumColumns() * i] = filterSet[j]->getdBAmplitude(evalFrequencies[i]);
-                }
-            }
+            //Compute B matrix with new gains (row i: all filters at evalFrequencies[i])
+            response.getdBMagnitudes(getFilterCoefficients().data(), dim, B_data);
 
             B.solve(lambda);
 
@@ -242,6 +453,59 @@ namespace reverb {
 
     }
 
+    /**
+    * @brief Evaluates the Equalizer amplitude response in dB at many frequencies at once
+    *
+    * Meant for drawing the EQ curve: the frequencies are tabulated once in the given
+    * MagnitudeResponse, and all filters are then evaluated at all of them in one go.
+    *
+    * @param [in]  response       Frequencies at which the response is evaluated
+    * @param [out] dBAmplitudes   Amplitude response at each frequency
+    */
+
+    void Equalizer::getdBAmplitudes(MagnitudeResponse& response, float* dBAmplitudes)
+    {
+        response.getTotaldBMagnitudes(getFilterCoefficients().data(), filterSet.size(), dBAmplitudes);
+    }
+
+    /**
+    * @brief Returns pointers to the current coefficients of each filter
+    *
+    * The pointers are invalidated when a filter parameter changes.
+    */
+
+    std::vector<const float*> Equalizer::getFilterCoefficients()
+    {
+        std::vector<const float*> coeffs;
+
+        for (int i = 0; i < filterSet.size(); i++)
+        {
+            filterSet[i]->getCoefficients();
+            coeffs.push_back(filterSet[i]->coefficients->getRawCoefficients());
+        }
+
+        return coeffs;
+    }
+
+    /**
+    * @brief Returns the current coefficients of all filters
+    *
+    * Five coefficients per filter (b0, b1, b2, a1, a2), in processing order. They fully
+    * determine what exec() does to the IR.
+    */
+
+    std::vector<float> Equalizer::getCoefficients()
+    {
+        std::vector<float> coeffs;
+
+        for (const float* filterCoeffs : getFilterCoefficients())
+        {
+            coeffs.insert(coeffs.end(), filterCoeffs, filterCoeffs + 5);
+        }
+
+        return coeffs;
+    }
+
     /**
     * @brief Returns the number of filters in the equalizer
     *
@@ -256,4 +520,20 @@ namespace reverb {
 
         return mustExec;
     }
+
+    /**
+    * @brief Marks the equalizer and its filters as up to date without running them
+    *
+    * Used when the filtered IR is obtained otherwise (e.g. from a cache).
+    */
+
+    void Equalizer::setUpToDate()
+    {
+        for (int i = 0; i < filterSet.size(); i++)
+        {
+            filterSet[i]->mustExec = false;
+        }
+
+        mustExec = false;
+    }
 }
\ No newline at end of file
@@ -10,6 +10,8 @@ Equalizer.h
 
 #include "Task.h"
 #include "Filter.h"
+#include "MagnitudeResponse.h"
+#include "WorkerPool.h"
 
 #include <memory>
 #include <exception>
@@ -43,18 +45,32 @@ namespace reverb {
 
         virtual void updateSampleRate(double sr) override;
 
+        void setWorkerPool(WorkerPool* pool);
+
 
         void calibrateFilters();
 
         float getdBAmplitude(float freq);
+        void getdBAmplitudes(MagnitudeResponse& response, float* dBAmplitudes);
+
+        std::vector<float> getCoefficients();
 
         int getNumFilters();
         virtual bool needsToRun() const override;
 
+        void setUpToDate();
+
+        static constexpr int MIN_NUM_FILTERS = 3;
+        static constexpr int MAX_NUM_FILTERS = 6;
+
 
     protected:
+        std::vector<const float*> getFilterCoefficients();
+
         juce::OwnedArray<Filter> filterSet;
         std::vector<float> EQGains;
+
+        WorkerPool* workerPool = nullptr;
     };
 
     struct InvalidFilterException : public std::exception 
@@ -49,7 +49,7 @@ namespace reverb
         if (frequency != _frequency)
         {
             frequency = _frequency;
-            buildFilter();
+            updateCoefficients();
             mustExec = true;
         }
 
@@ -60,7 +60,7 @@ namespace reverb
         if (Q != _Q)
         {
             Q = _Q;
-            buildFilter();
+            updateCoefficients();
             mustExec = true;
         }
 
@@ -80,7 +80,11 @@ namespace reverb
     */
     AudioBlock Filter::exec(AudioBlock ir)
     {
-        buildFilter();
+        // Coefficients are cached: only rebuild them if the sample rate changed
+        if (!hasValidCoefficients())
+        {
+            updateCoefficients();
+        }
 
         if (ir.getNumChannels() != 1)
         {
@@ -144,6 +148,70 @@ namespace reverb
         return 20 * std::log10(getAmplitude(freq));
     }
 
+    //==============================================================================
+    /**
+    * @brief Returns the complex response (magnitude and phase) of a biquad at a given frequency
+    *
+    * @param [in] coeffs      Filter coefficients (2nd order, normalised so that a0 = 1)
+    * @param [in] frequency   Normalised frequency (cycles per sample, 0 to 0.5)
+    *
+    * @return Transfer function evaluated at e^(j * 2 * pi * frequency)
+    */
+    std::complex<double> Filter::getResponse(const juce::dsp::IIR::Coefficients<float>& coeffs,
+                                             double frequency)
+    {
+        const double b0 = coeffs.coefficients[0];
+        const double b1 = coeffs.coefficients[1];
+        const double b2 = coeffs.coefficients[2];
+        const double a1 = coeffs.coefficients[3];
+        const double a2 = coeffs.coefficients[4];
+
+        // z^-1 and z^-2
+        const double omega = 2.0 * juce::MathConstants<double>::pi * frequency;
+        const std::complex<double> z1 = std::polar(1.0, -omega);
+        const std::complex<double> z2 = z1 * z1;
+
+        return (b0 + b1 * z1 + b2 * z2) / (1.0 + a1 * z1 + a2 * z2);
+    }
+
+    //==============================================================================
+    /**
+    * @brief Returns the filter coefficients, rebuilding them only if they are out of date
+    *
+    * @return Coefficients for the current parameters and sample rate
+    */
+    const juce::dsp::IIR::Coefficients<float>& Filter::getCoefficients()
+    {
+        if (!hasValidCoefficients())
+        {
+            updateCoefficients();
+        }
+
+        return *coefficients;
+    }
+
+    //==============================================================================
+    /**
+    * @brief Rebuilds the filter coefficients from the current parameters and sample rate
+    */
+    void Filter::updateCoefficients()
+    {
+        buildFilter();
+
+        coefficientsSampleRate = processor->getSampleRate();
+    }
+
+    /**
+    * @brief Checks whether the coefficients were built for the current sample rate
+    *
+    * Parameter setters rebuild the coefficients straight away, so only the sample rate
+    * can make them stale.
+    */
+    bool Filter::hasValidCoefficients() const
+    {
+        return coefficients != nullptr && coefficientsSampleRate == processor->getSampleRate();
+    }
+
     //==============================================================================
     /**
     * @brief Sets the filter frequency and updates the IIR filter coefficients (Meant to be used by Equalizer class)
@@ -157,7 +225,7 @@ namespace reverb
 
         frequency = freq;
 
-        buildFilter();
+        updateCoefficients();
     }
 
     //==============================================================================
@@ -172,7 +240,7 @@ namespace reverb
 
         Q = q;
 
-        buildFilter();
+        updateCoefficients();
     }
     //==============================================================================
     /**
@@ -186,7 +254,7 @@ namespace reverb
 
         gainFactor = gain;
 
-        buildFilter();
+        updateCoefficients();
     }
 
     //==============================================================================
@@ -8,6 +8,7 @@ Filter.h
 
 #include "Task.h"
 
+#include <complex>
 #include <memory>
 
 #ifndef M_PI
@@ -58,6 +59,11 @@ namespace reverb
         float getAmplitude(float freq);
         float getdBAmplitude(float freq);
 
+        static std::complex<double> getResponse(const juce::dsp::IIR::Coefficients<float>& coeffs,
+                                                double frequency);
+
+        const juce::dsp::IIR::Coefficients<float>& getCoefficients();
+
     protected:
         void setFrequency(float);
         void setQ(float);
@@ -65,10 +71,16 @@ namespace reverb
 
         virtual void buildFilter() = 0;
 
+        void updateCoefficients();
+        bool hasValidCoefficients() const;
+
         float frequency;
         float Q;
         float gainFactor;
 
+        // Sample rate the coefficients were built for
+        double coefficientsSampleRate = 0.0;
+
     };
 
 
@@ -48,7 +48,8 @@ namespace reverb
     /**
      * @brief Apply Gain to input buffer to change volume of signal audio 
      *
-     * Gain to apply to audio buffer is stocked in gainFactor
+     * Gain to apply to audio buffer is stocked in gainFactor. The gain is constant
+     * over the buffer (e.g. an IR); streamed audio should use getNextRamp() instead.
      *
      * @param [in,out] buffer   Audio sample buffer to process
      */
@@ -62,4 +63,22 @@ namespace reverb
         return buffer;
     }
 
+    /**
+     * @brief Returns the gain ramp for the next block and moves on to it
+     *
+     * Lets another step apply the gain to streamed audio (e.g. fused with mixing),
+     * ramping it over a block when it changed since the last one.
+     *
+     * @param [out] start   Gain at the start of the block
+     * @param [out] end     Gain at the end of the block
+     */
+    void Gain::getNextRamp(float& start, float& end)
+    {
+        start = hasAppliedGainFactor ? appliedGainFactor : gainFactor;
+        end = gainFactor;
+
+        appliedGainFactor = gainFactor;
+        hasAppliedGainFactor = true;
+    }
+
 }
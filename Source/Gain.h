@@ -32,9 +32,16 @@ namespace reverb
 
         virtual AudioBlock exec(AudioBlock buffer) override;
 
+        //==============================================================================
+        void getNextRamp(float& start, float& end);
+
     protected:
         //==============================================================================
         float gainFactor = 1.0f;
+
+        // Gain reached at the end of the last block (start of the next ramp)
+        float appliedGainFactor = 1.0f;
+        bool hasAppliedGainFactor = false;
     };
 
 }
\ No newline at end of file
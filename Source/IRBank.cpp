@@ -8,6 +8,10 @@
 
 #include "IRBank.h"
 
+#include "IRResources.h"
+
+#include <stdexcept>
+
 namespace reverb
 {
 
@@ -25,62 +29,72 @@ namespace reverb
     /**
      * @brief Construct IR bank
      *
-     * Sets public buffer & sample rate references and calls build() method to populate
-     * IR bank.
+     * Sets public IR info reference and calls build() method to populate IR bank.
      */
     IRBank::IRBank()
-        : buffers(buffersModifiable), sampleRates(sampleRatesModifiable)
+        : irs(irsModifiable)
     {
         build();
     }
 
     //==============================================================================
     /**
-     * @brief Build IR bank from binary data
+     * @brief Build IR bank from pre-decoded IR resources
      *
-     * Finds all audio resources and builds sample buffers for each. Rejects any
-     * resources with the wrong format (only keep WAVE or AIFF).
+     * Indexes the IRs listed in IRResources.h. Samples are used in place.
      */
     void IRBank::build()
     {
-        if (!buffersModifiable.empty() && !sampleRatesModifiable.empty())
+        if (!irsModifiable.empty())
         {
             return;
         }
-        else if (buffersModifiable.size() != sampleRatesModifiable.size())
-        {
-            buffersModifiable.clear();
-            sampleRatesModifiable.clear();
-        }
-
-        // Register basic audio formats
-        juce::AudioFormatManager formatMgr;
-        formatMgr.registerBasicFormats();
 
-        for (int i = 0; i < BinaryData::namedResourceListSize; ++i)
+        for (int i = 0; i < IRResources::NUM_IRS; ++i)
         {
-            // Prepare memory input stream
-            int dataSize;
-            const char * data;
+            const IRResources::Info& resource = IRResources::infos[i];
 
-            data = BinaryData::getNamedResource(BinaryData::namedResourceList[i], dataSize);
-            auto dataStream = new juce::MemoryInputStream(data, dataSize, false);
+            IRInfo& info = irsModifiable[resource.name];
 
-            // Attempt to create an audio format reader for stream
-            std::unique_ptr<juce::AudioFormatReader> reader(formatMgr.createReaderFor(dataStream));
+            info.numChannels = resource.numChannels;
+            info.numSamples = resource.numSamples;
+            info.sampleRate = resource.sampleRate;
+            info.contentHash = resource.contentHash;
 
-            // If reader was successfully created, this is a valid audio resource
-            if (reader)
+            // Views are only read from (AudioBlock has no read-only flavour)
+            float* samples = const_cast<float*>(IRResources::samples[i]);
+
+            for (int channel = 0; channel < resource.numChannels; ++channel)
             {
-                int numChannels = reader->numChannels;
-                int numSamples = (int)reader->lengthInSamples;
+                info.channels.push_back(samples + channel * resource.channelStride);
+            }
+        }
+    }
 
-                buffersModifiable[BinaryData::namedResourceList[i]] = juce::AudioSampleBuffer(numChannels, numSamples);
-                reader->read(&buffersModifiable[BinaryData::namedResourceList[i]], 0, numSamples, 0, true, true);
+    //==============================================================================
+    /**
+     * @brief Returns a view of an IR's samples
+     *
+     * The samples are part of the plugin binary: the view remains valid for the life
+     * of the process and must not be written to.
+     *
+     * @param [in] irName   Name of banked IR
+     *
+     * @throws std::invalid_argument
+     */
+    juce::dsp::AudioBlock<float> IRBank::getBlock(const std::string& irName) const
+    {
+        const auto irIter = irs.find(irName);
 
-                sampleRatesModifiable[BinaryData::namedResourceList[i]] = reader->sampleRate;
-            }
+        if (irIter == irs.end())
+        {
+            throw std::invalid_argument("Requested impulse response (" + irName + ") does not exist in IR bank");
         }
+
+        const IRInfo& info = irIter->second;
+
+        return juce::dsp::AudioBlock<float>(info.channels.data(),
+                                            (size_t)info.numChannels, (size_t)info.numSamples);
     }
 
-}
\ No newline at end of file
+}
@@ -11,13 +11,36 @@
 #include "JuceHeader.h"
 
 #include <map>
+#include <vector>
 
 namespace reverb
 {
 
+    //==============================================================================
+    /**
+     * Impulse responses bundled with the plugin.
+     *
+     * IRs are converted to float arrays at build time (see IRResources.h), so the bank
+     * hands out views of their samples in place: nothing is decoded, allocated or copied
+     * when the IRs are used, and samples only take up memory once they are read.
+     */
     class IRBank
     {
     public:
+        //==============================================================================
+        struct IRInfo
+        {
+            int numChannels = 0;
+            int numSamples = 0;
+            double sampleRate = 0.0;
+
+            // Identifies the IR's samples (see IRResources.h)
+            std::string contentHash;
+
+            // Start of each channel's samples
+            std::vector<float*> channels;
+        };
+
         //==============================================================================
         IRBank();
 
@@ -28,15 +51,16 @@ namespace reverb
         static const IRBank& getInstance();
 
         //==============================================================================
-        const std::map<std::string, juce::AudioSampleBuffer>& buffers;
-        const std::map<std::string, double>& sampleRates;
+        juce::dsp::AudioBlock<float> getBlock(const std::string& irName) const;
+
+        //==============================================================================
+        const std::map<std::string, IRInfo>& irs;
 
     protected:
         //==============================================================================
         void build();
 
-        std::map<std::string, juce::AudioSampleBuffer> buffersModifiable;
-        std::map<std::string, double> sampleRatesModifiable;
+        std::map<std::string, IRInfo> irsModifiable;
     };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,321 @@
+/*
+  ==============================================================================
+
+    IRFileCache.cpp
+
+  ==============================================================================
+*/
+
+#include "IRFileCache.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * @brief Returns the size of a decoded IR in bytes
+     */
+    static size_t getNumBytes(const IRFileCache::DecodedIR& ir)
+    {
+        return (size_t)ir.buffer.getNumChannels() * (size_t)ir.buffer.getNumSamples() * sizeof(float);
+    }
+
+    //==============================================================================
+    /**
+     * Global IRFileCache object
+     */
+    IRFileCache& IRFileCache::getInstance()
+    {
+        static IRFileCache cache;
+        return cache;
+    }
+
+    //==============================================================================
+    /**
+     * @brief Opens an IR file
+     *
+     * Only reads the file if it isn't cached or changed since it was decoded. Short files
+     * are decoded (and cached) right away, long files are only read by Source::read().
+     * Cached IRs remain valid as long as they are referenced, even if the cache drops
+     * them in the meantime.
+     *
+     * @param [in] filePath Path to IR file (.WAV or .AIFF)
+     *
+     * @throws std::invalid_argument
+     * @throws std::runtime_error
+     */
+    IRFileCache::Source IRFileCache::open(const std::string& filePath)
+    {
+        const juce::File file(filePath);
+
+        const juce::int64 modificationTime = file.getLastModificationTime().toMilliseconds();
+        const juce::int64 fileSize = file.getSize();
+
+        Source source;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            const auto entryIter = std::find_if(entries.begin(), entries.end(),
+                                                [&](const std::pair<std::string, DecodedIRPtr>& entry) {
+                return entry.first == filePath &&
+                       entry.second->modificationTime == modificationTime &&
+                       entry.second->fileSize == fileSize;
+            });
+
+            if (entryIter != entries.end())
+            {
+                entries.splice(entries.begin(), entries, entryIter);
+                source.decoded = entries.front().second;
+            }
+        }
+
+        if (!source.decoded)
+        {
+            source.reader = createReader(file);
+
+            const size_t numBytes = (size_t)source.reader->numChannels *
+                                    (size_t)source.reader->lengthInSamples * sizeof(float);
+
+            // Decode short files without holding the lock, so other files can be served
+            // meanwhile
+            if (numBytes <= MAX_CACHED_FILE_BYTES)
+            {
+                auto decoded = std::make_shared<DecodedIR>();
+
+                decoded->buffer.setSize((int)source.reader->numChannels,
+                                        (int)source.reader->lengthInSamples);
+                readChunks(*source.reader, decoded->buffer, 0, decoded->buffer.getNumSamples());
+
+                decoded->sampleRate = source.reader->sampleRate;
+                decoded->modificationTime = modificationTime;
+                decoded->fileSize = fileSize;
+
+                source.decoded = decoded;
+                source.reader.reset();
+
+                std::lock_guard<std::mutex> lock(mutex);
+
+                // Drop any other version of the file (including one decoded concurrently)
+                for (auto entryIter = entries.begin(); entryIter != entries.end();)
+                {
+                    if (entryIter->first == filePath)
+                    {
+                        memoryUsage -= getNumBytes(*entryIter->second);
+                        entryIter = entries.erase(entryIter);
+                    }
+                    else
+                    {
+                        ++entryIter;
+                    }
+                }
+
+                entries.emplace_front(filePath, source.decoded);
+                memoryUsage += getNumBytes(*source.decoded);
+
+                evict();
+            }
+        }
+
+        if (source.decoded)
+        {
+            source.numChannels = source.decoded->buffer.getNumChannels();
+            source.numSamples = source.decoded->buffer.getNumSamples();
+            source.sampleRate = source.decoded->sampleRate;
+        }
+        else
+        {
+            source.numChannels = (int)source.reader->numChannels;
+            source.numSamples = (int)source.reader->lengthInSamples;
+            source.sampleRate = source.reader->sampleRate;
+        }
+
+        source.modificationTime = modificationTime;
+
+        return source;
+    }
+
+    /**
+     * @brief Copies the IR to a buffer
+     *
+     * Each channel of the buffer gets a channel of the IR, taken in turn (e.g. both
+     * channels of a stereo buffer get the only channel of a mono IR). Streamed files are
+     * read in chunks of CHUNK_NUM_SAMPLES.
+     *
+     * @param [out] dest    Buffer of at least getNumSamples() samples
+     *
+     * @throws std::runtime_error
+     */
+    void IRFileCache::Source::read(juce::AudioSampleBuffer& dest) const
+    {
+        read(dest, 0, numSamples);
+    }
+
+    /**
+     * @brief Copies a section of the IR to a buffer
+     *
+     * Same as read(), but only for the given samples. Streamed files only have that
+     * section read (and mapped).
+     *
+     * @param [out] dest                Buffer of at least numSamplesToRead samples
+     * @param [in]  startSample         First sample of the IR to copy
+     * @param [in]  numSamplesToRead    Number of samples to copy
+     *
+     * @throws std::runtime_error
+     */
+    void IRFileCache::Source::read(juce::AudioSampleBuffer& dest, int startSample, int numSamplesToRead) const
+    {
+        jassert(startSample >= 0 && startSample + numSamplesToRead <= numSamples);
+        jassert(dest.getNumSamples() >= numSamplesToRead);
+
+        const int numDestChannels = dest.getNumChannels();
+
+        if (decoded)
+        {
+            for (int channel = 0; channel < numDestChannels; ++channel)
+            {
+                dest.copyFrom(channel, 0, decoded->buffer, channel % numChannels, startSample, numSamplesToRead);
+            }
+
+            return;
+        }
+
+        readChunks(*reader, dest, startSample, numSamplesToRead);
+    }
+
+    //==============================================================================
+    /**
+     * @brief Sets the memory budget for decoded files
+     *
+     * Drops least recently used files until the budget is met.
+     *
+     * @param [in] numBytes Maximum size of decoded files kept in memory
+     */
+    void IRFileCache::setMemoryBudget(size_t numBytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        memoryBudget = numBytes;
+        evict();
+    }
+
+    /**
+     * @brief Returns the size of decoded files currently kept in memory, in bytes
+     */
+    size_t IRFileCache::getMemoryUsage() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return memoryUsage;
+    }
+
+    //==============================================================================
+    /**
+     * @brief Creates a reader for an IR file, memory-mapped if the format supports it
+     *
+     * @param [in] file IR file
+     *
+     * @throws std::invalid_argument
+     */
+    std::unique_ptr<juce::AudioFormatReader> IRFileCache::createReader(const juce::File& file)
+    {
+        juce::AudioFormatManager formatMgr;
+        formatMgr.registerBasicFormats();
+
+        juce::AudioFormat* format = formatMgr.findFormatForFileExtension(file.getFileExtension());
+
+        if (format != nullptr)
+        {
+            std::unique_ptr<juce::AudioFormatReader> reader(format->createMemoryMappedReader(file));
+
+            if (reader)
+            {
+                return reader;
+            }
+        }
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formatMgr.createReaderFor(file));
+
+        if (!reader)
+        {
+            throw std::invalid_argument("Failed to create reader for IR file: " +
+                                        file.getFullPathName().toStdString());
+        }
+
+        return reader;
+    }
+
+    /**
+     * @brief Reads a section of a file in chunks
+     *
+     * Each channel of the buffer gets a channel of the file, taken in turn. Memory-mapped
+     * readers only map the chunk being read, so the mapping doesn't grow with the file.
+     *
+     * @param [in]  reader      Reader for IR file
+     * @param [out] dest        Buffer with enough samples for the section
+     * @param [in]  startSample First sample of the file to read
+     * @param [in]  numSamples  Number of samples to read
+     *
+     * @throws std::runtime_error
+     */
+    void IRFileCache::readChunks(juce::AudioFormatReader& reader, juce::AudioSampleBuffer& dest,
+                                 int startSample, int numSamples)
+    {
+        auto mappedReader = dynamic_cast<juce::MemoryMappedAudioFormatReader*>(&reader);
+
+        const int numChannels = (int)reader.numChannels;
+        const int numDestChannels = dest.getNumChannels();
+
+        // Read directly into destination if channels match, through a chunk otherwise
+        const bool readDirectly = (numDestChannels == numChannels);
+
+        juce::AudioSampleBuffer chunk;
+        if (!readDirectly)
+        {
+            chunk.setSize(numChannels, std::min(CHUNK_NUM_SAMPLES, numSamples));
+        }
+
+        for (int start = 0; start < numSamples; start += CHUNK_NUM_SAMPLES)
+        {
+            const int chunkNumSamples = std::min(CHUNK_NUM_SAMPLES, numSamples - start);
+            const juce::int64 fileStart = (juce::int64)startSample + start;
+
+            if (mappedReader != nullptr &&
+                !mappedReader->mapSectionOfFile(juce::Range<juce::int64>(fileStart, fileStart + chunkNumSamples)))
+            {
+                throw std::runtime_error("Failed to map IR file section");
+            }
+
+            if (readDirectly)
+            {
+                reader.read(&dest, start, chunkNumSamples, fileStart, true, true);
+                continue;
+            }
+
+            reader.read(&chunk, 0, chunkNumSamples, fileStart, true, true);
+
+            for (int channel = 0; channel < numDestChannels; ++channel)
+            {
+                dest.copyFrom(channel, start, chunk, channel % numChannels, 0, chunkNumSamples);
+            }
+        }
+    }
+
+    /**
+     * @brief Drops least recently used files until the memory budget is met
+     *
+     * Must be called with the mutex held. The most recently used file is always kept.
+     */
+    void IRFileCache::evict()
+    {
+        while (memoryUsage > memoryBudget && entries.size() > 1)
+        {
+            memoryUsage -= getNumBytes(*entries.back().second);
+            entries.pop_back();
+        }
+    }
+
+}
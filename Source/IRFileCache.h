@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    IRFileCache.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * Process-wide cache of IR files decoded from disk.
+     *
+     * Files are decoded once, all channels in a single read, and kept for later
+     * requests (e.g. from other plugin instances or when the IR is rebuilt) as long as
+     * their modification time and size don't change. Decoded files are kept within a
+     * memory budget, dropping the least recently used ones first.
+     *
+     * Long files (more than MAX_CACHED_FILE_BYTES decoded) are not cached: they are
+     * streamed from a memory-mapped reader (WAV and AIFF) in chunks straight into the
+     * caller's buffer. They may also be read one section at a time (e.g. to convert
+     * them while reading), so they never have to be held in full.
+     *
+     * open() may be called from any thread.
+     */
+    class IRFileCache
+    {
+    public:
+        //==============================================================================
+        struct DecodedIR
+        {
+            juce::AudioSampleBuffer buffer;
+            double sampleRate = 0.0;
+
+            // Identify the file version the samples were decoded from
+            juce::int64 modificationTime = 0;
+            juce::int64 fileSize = 0;
+        };
+
+        using DecodedIRPtr = std::shared_ptr<const DecodedIR>;
+
+        //==============================================================================
+        /**
+         * An opened IR file, either cached or streamed from disk.
+         */
+        class Source
+        {
+        public:
+            int getNumChannels() const { return numChannels; }
+            int getNumSamples() const { return numSamples; }
+            double getSampleRate() const { return sampleRate; }
+            juce::int64 getModificationTime() const { return modificationTime; }
+
+            // Null if the file is streamed
+            DecodedIRPtr getDecodedIR() const { return decoded; }
+
+            void read(juce::AudioSampleBuffer& dest) const;
+            void read(juce::AudioSampleBuffer& dest, int startSample, int numSamplesToRead) const;
+
+        private:
+            friend class IRFileCache;
+
+            int numChannels = 0;
+            int numSamples = 0;
+            double sampleRate = 0.0;
+            juce::int64 modificationTime = 0;
+
+            DecodedIRPtr decoded;
+            std::unique_ptr<juce::AudioFormatReader> reader;
+        };
+
+        //==============================================================================
+        IRFileCache() = default;
+
+        IRFileCache(const IRFileCache&) = delete;
+        IRFileCache& operator=(const IRFileCache&) = delete;
+
+        //==============================================================================
+        static IRFileCache& getInstance();
+
+        //==============================================================================
+        Source open(const std::string& filePath);
+
+        void setMemoryBudget(size_t numBytes);
+        size_t getMemoryUsage() const;
+
+        //==============================================================================
+        // Decoded files kept in memory (the most recently used file is always kept)
+        static constexpr size_t DEFAULT_MEMORY_BUDGET = 32 * 1024 * 1024;
+
+        // Larger files are streamed instead of cached (~20 s of stereo at 48 kHz)
+        static constexpr size_t MAX_CACHED_FILE_BYTES = 8 * 1024 * 1024;
+
+        // Samples per channel read at once
+        static constexpr int CHUNK_NUM_SAMPLES = 65536;
+
+    protected:
+        //==============================================================================
+        static std::unique_ptr<juce::AudioFormatReader> createReader(const juce::File& file);
+        static void readChunks(juce::AudioFormatReader& reader, juce::AudioSampleBuffer& dest,
+                               int startSample, int numSamples);
+
+        void evict();
+
+        //==============================================================================
+        mutable std::mutex mutex;
+
+        // Most recently used first
+        std::list<std::pair<std::string, DecodedIRPtr>> entries;
+
+        size_t memoryBudget = DEFAULT_MEMORY_BUDGET;
+        size_t memoryUsage = 0;
+    };
+
+}
@@ -9,6 +9,7 @@
 #include "IRPipeline.h"
 
 #include "IRBank.h"
+#include "IRFileCache.h"
 #include "Logger.h"
 #include "PluginProcessor.h"
 
@@ -17,6 +18,15 @@
 namespace reverb
 {
 
+    //==============================================================================
+    /**
+     * @brief Returns the size of a buffer's samples in bytes
+     */
+    static size_t getNumBytes(const juce::AudioSampleBuffer& buffer)
+    {
+        return (size_t)buffer.getNumChannels() * (size_t)buffer.getNumSamples() * sizeof(float);
+    }
+
     //==============================================================================
     /**
      * @brief Constructs an IRPipeline object associated with an AudioProcessor
@@ -26,15 +36,12 @@ namespace reverb
      *
      * @param [in] processor    Pointer to main processor
      */
-    IRPipeline::IRPipeline(juce::AudioProcessor * processor, int channelIdx)
-        : Task(processor),
-          channelIdx(channelIdx)
+    IRPipeline::IRPipeline(juce::AudioProcessor * processor)
+        : Task(processor)
     {
         // Initialise pipeline steps
         equalizer = std::make_shared<Equalizer>(processor);
         timeStretch = std::make_shared<TimeStretch>(processor);
-        gain = std::make_shared<Gain>(processor);
-        preDelay = std::make_shared<PreDelay>(processor);
     }
 
     /**
@@ -71,18 +78,76 @@ namespace reverb
             }
         }
 
-        gain->updateParams(params, AudioProcessor::PID_IR_GAIN);
-        preDelay->updateParams(params, AudioProcessor::PID_PREDELAY);
         timeStretch->updateParams(params, AudioProcessor::PID_IR_LENGTH);
+
+        const bool useEnvelope = getParam(params, AudioProcessor::PID_IR_LENGTH_MODE) >= 0.5f;
+        timeStretch->setLengthMode(useEnvelope ? TimeStretch::LengthMode::Envelope
+                                               : TimeStretch::LengthMode::SoundTouch);
+    }
+
+    //==============================================================================
+    /**
+     * @brief Sets the number of audio channels the IR is processed for
+     *
+     * @param [in] numChannels  Number of audio channels
+     */
+    void IRPipeline::setNumChannels(int numChannels)
+    {
+        jassert(numChannels > 0);
+
+        if (numChannels != this->numChannels)
+        {
+            this->numChannels = numChannels;
+            mustExec = true;
+        }
+    }
+
+    /**
+     * @brief Sets the worker pool the pipeline may spread its work on
+     *
+     * @param [in] pool Worker pool (may be null), must outlive the pipeline or be unset
+     */
+    void IRPipeline::setWorkerPool(WorkerPool* pool)
+    {
+        equalizer->setWorkerPool(pool);
+        timeStretch->setWorkerPool(pool);
+    }
+
+    /**
+     * @brief Sets the cache processed IRs are fetched from and stored to
+     *
+     * @param [in] cache    Processed IR cache (null to disable), must outlive the pipeline
+     *                      or be unset
+     */
+    void IRPipeline::setProcessedIRCache(ProcessedIRCache* cache)
+    {
+        processedIRCache = cache;
+    }
+
+    /**
+     * @brief Returns the number of channels in the processed IR
+     *
+     * One IR channel per audio channel, taken from the source channels in turn (e.g. mono
+     * IRs feed both stereo channels). A stereo signal gets all four channels of a
+     * true-stereo IR.
+     */
+    int IRPipeline::getNumIRChannels() const
+    {
+        if (numChannels == 2 && numSourceChannels == NUM_TRUE_STEREO_IR_CHANNELS)
+        {
+            return NUM_TRUE_STEREO_IR_CHANNELS;
+        }
+
+        return numChannels;
     }
 
     //==============================================================================
     /**
      * @brief Update sample rate for pipeline and child tasks
      * 
-     * Compares new sample rate with previous value. If different, sets mustExec to
-     * true in order to re-run pipeline for new sample rate. Store new sample rate
-     * value in object.
+     * Compares new sample rate with previous value. If different, flags the IR for
+     * conversion to the new rate (it doesn't need to be reloaded). Store new sample
+     * rate value in object.
      *
      * @param [in] sr   Sample rate
      */
@@ -91,11 +156,9 @@ namespace reverb
         if (sr != sampleRate)
         {
             sampleRate = sr;
-            mustExec = true;
+            mustResample = true;
 
             equalizer->updateSampleRate(sr);
-            gain->updateSampleRate(sr);
-            preDelay->updateSampleRate(sr);
             timeStretch->updateSampleRate(sr);
         }
     }
@@ -111,87 +174,289 @@ namespace reverb
      */
     bool IRPipeline::needsToRun() const
     {
-        if (mustExec)
+        if (mustExec || mustResample)
         {
             return true;
         }
 
-        if (equalizer->needsToRun())
+        if (timeStretch->needsToRun())
         {
             return true;
         }
 
-        if (timeStretch->needsToRun())
+        if (equalizer->needsToRun())
         {
             return true;
         }
 
-        if (gain->needsToRun())
+        return false;
+    }
+
+    /**
+     * @brief Returns the first pipeline stage whose output is out of date
+     *
+     * A stage must be re-run if its parameters changed since it last ran. All stages
+     * after it must then be re-run as well, since their input changed. A stage can't
+     * start from the output of a stage that is out of date (e.g. skipped on a processed IR
+     * cache hit), which must then be re-run first.
+     *
+     * @returns First stage to run, or NUM_STAGES if the cached IR is up to date
+     */
+    int IRPipeline::getFirstStageToRun() const
+    {
+        int firstStage = NUM_STAGES;
+
+        if (mustExec)
         {
-            return true;
+            firstStage = STAGE_LOAD;
         }
-
-        if (preDelay->needsToRun())
+        else if (mustResample)
         {
-            return true;
+            // IRs converted while being loaded aren't kept at their native rate
+            firstStage = (loadedSampleRate == irSampleRate) ? STAGE_RESAMPLE : STAGE_LOAD;
+        }
+        else if (timeStretch->needsToRun())
+        {
+            firstStage = STAGE_TIME_STRETCH;
+        }
+        else if (equalizer->needsToRun())
+        {
+            firstStage = STAGE_EQUALIZER;
         }
 
-        return false;
+        return (firstStage < NUM_STAGES) ? std::min(firstStage, numStageOutputs) : firstStage;
     }
 
     //==============================================================================
     /**
      * @brief Manipulate the input IR file and place it in the given buffer
      *
-     * Applies filtering (EQ), time stretching (sample rate conversion) and gain to
-     * internal IR channel buffers to prepare it for main audio processing, then write
-     * channels to given output buffer.
+     * Converts internal IR channel buffers to the host sample rate and applies time
+     * stretching and filtering (EQ) to prepare them for main audio processing, then write
+     * channels to given output buffer. IR gain is applied to the wet signal by MainPipeline.
+     *
+     * Stages before the first one whose parameters changed are skipped: the next stage
+     * starts from their cached output instead. If the processed IR cache has the IR for
+     * current settings, no stage runs at all. Otherwise, the processed IR is stored to
+     * the cache in the background.
+     *
+     * The IR is built aside and only replaces the previous one once every stage
+     * succeeded, so blocks returned by a previous run (e.g. held by the main pipelines)
+     * stay valid if a stage throws.
      *
-     * @param [out] irChannelOut    Processed impulse response channel
+     * @returns Processed impulse response (getNumIRChannels() channels)
      *
      * @throws std::runtime_error
      */
     AudioBlock IRPipeline::exec(AudioBlock)
     {
-        AudioBlock irBlock = reloadIR();
+        const int firstStage = getFirstStageToRun();
 
-        // Apply filters
-        equalizer->exec(irBlock);
+        ProcessedIRCache::Key cacheKey;
 
-        // Apply gain
-        gain->exec(irBlock);
+        if (processedIRCache != nullptr && firstStage < NUM_STAGES)
+        {
+            cacheKey = getProcessedIRKey();
 
-        // Resize buffer and apply timestretch
-        timeStretch->prepareIR(ir);
-        irBlock = ir;
+            if (processedIRCache->load(cacheKey, ir, numSourceChannels))
+            {
+                // Outputs of the stages that were skipped are out of date, earlier ones
+                // are still valid
+                numStageOutputs = std::min(numStageOutputs, firstStage);
 
-        timeStretch->exec(irBlock);
+                mustExec = false;
+                mustResample = false;
+                timeStretch->setUpToDate();
+                equalizer->setUpToDate();
 
-        // Resize buffer and apply predelay
-        preDelay->prepareIR(ir);
-        irBlock = ir;
+                return AudioBlock(ir);
+            }
+        }
+
+        // If a stage throws, start from it next time
+        numStageOutputs = std::min(numStageOutputs, firstStage);
+
+        juce::AudioSampleBuffer processedIR;
+
+        for (int stage = firstStage; stage < NUM_STAGES; ++stage)
+        {
+            switch (stage)
+            {
+                case STAGE_LOAD:
+                {
+                    juce::AudioSampleBuffer loadedIR;
+                    loadIR(loadedIR);
+                    stageOutputs[STAGE_LOAD] = std::make_shared<const juce::AudioSampleBuffer>(std::move(loadedIR));
+                    break;
+                }
+
+                case STAGE_RESAMPLE:
+                    // Shared with the resampled IR cache (or the loaded IR if already at
+                    // host rate)
+                    stageOutputs[STAGE_RESAMPLE] = resampleIR(stageOutputs[STAGE_LOAD]);
+                    break;
+
+                case STAGE_TIME_STRETCH:
+                {
+                    // Resize buffer and apply timestretch (reading the input in place)
+                    auto stretched = std::make_shared<juce::AudioSampleBuffer>();
+                    timeStretch->prepareIR(stageOutputs[STAGE_RESAMPLE], *stretched);
+                    timeStretch->exec(AudioBlock(*stretched));
+                    stageOutputs[STAGE_TIME_STRETCH] = std::move(stretched);
+                    break;
+                }
+
+                case STAGE_EQUALIZER:
+                    // Apply filters
+                    processedIR.makeCopyOf(*stageOutputs[STAGE_TIME_STRETCH]);
+                    equalizer->exec(AudioBlock(processedIR));
+                    break;
+
+                default:
+                    jassertfalse;
+                    break;
+            }
+        }
 
-        preDelay->exec(irBlock);
+        numStageOutputs = NUM_STAGES - 1;
 
-        // Reset mustExec flag
+        // Reset flags
         mustExec = false;
+        mustResample = false;
 
-        // Return reference to processed IR channel
-        return irBlock;
+        if (firstStage < NUM_STAGES)
+        {
+            ir = std::move(processedIR);
+
+            if (processedIRCache != nullptr)
+            {
+                processedIRCache->store(cacheKey, ir, numSourceChannels);
+            }
+        }
+
+        // Return reference to processed IR
+        return AudioBlock(ir);
+    }
+
+    /**
+     * @brief Converts the IR to the host sample rate
+     *
+     * Reuses the result of a previous conversion of the same IR to the same rate if it
+     * is still cached. New conversions are cached, least recently used ones being
+     * dropped to stay within MAX_RESAMPLED_IR_BYTES. IRs already at the host rate are
+     * returned as is.
+     *
+     * @param [in] buffer   IR at its native rate
+     *
+     * @returns IR at the host rate, shared with the cache
+     */
+    IRPipeline::BufferPtr IRPipeline::resampleIR(const BufferPtr& buffer)
+    {
+        if (loadedSampleRate <= 0.0 || sampleRate <= 0.0 || loadedSampleRate == sampleRate)
+        {
+            return buffer;
+        }
+
+        const int numIRChannels = buffer->getNumChannels();
+
+        const auto cached = std::find_if(resampledIRs.begin(), resampledIRs.end(),
+                                         [&](const ResampledIR& entry) {
+            return entry.irNameOrFilePath == irNameOrFilePath &&
+                   entry.irVersion == irVersion &&
+                   entry.numChannels == numIRChannels &&
+                   entry.sampleRate == sampleRate;
+        });
+
+        if (cached != resampledIRs.end())
+        {
+            resampledIRs.splice(resampledIRs.begin(), resampledIRs, cached);
+            return cached->buffer;
+        }
+
+        auto resampled = std::make_shared<juce::AudioSampleBuffer>();
+        Resampler(loadedSampleRate, sampleRate).process(*buffer, *resampled);
+
+        resampledIRs.push_front({ irNameOrFilePath, irVersion, numIRChannels, sampleRate, resampled });
+        resampledIRsNumBytes += getNumBytes(*resampled);
+
+        // Dropped IRs stay valid while still used as a stage output
+        while (resampledIRsNumBytes > MAX_RESAMPLED_IR_BYTES && resampledIRs.size() > 1)
+        {
+            resampledIRsNumBytes -= getNumBytes(*resampledIRs.back().buffer);
+            resampledIRs.pop_back();
+        }
+
+        return resampled;
+    }
+
+    /**
+     * @brief Returns the key of the processed IR for current settings
+     *
+     * Banked IRs are identified by name and content (the hash of the whole resource file,
+     * so it covers its format too), IR files by path, modification time and size. The EQ
+     * is identified by its filter coefficients.
+     */
+    ProcessedIRCache::Key IRPipeline::getProcessedIRKey() const
+    {
+        ProcessedIRCache::Key key;
+
+        key.irNameOrFilePath = irNameOrFilePath;
+
+        const auto& irBank = IRBank::getInstance();
+        const auto bankedIR = irBank.irs.find(irNameOrFilePath);
+
+        if (bankedIR != irBank.irs.end())
+        {
+            key.irContentHash = bankedIR->second.contentHash;
+        }
+        else
+        {
+            const juce::File irFile(irNameOrFilePath);
+
+            key.irVersion = irFile.getLastModificationTime().toMilliseconds();
+            key.irSize = irFile.getSize();
+        }
+
+        key.numChannels = numChannels;
+        key.sampleRate = sampleRate;
+        key.irLengthS = timeStretch->getIRLength();
+        key.lengthMode = (int)timeStretch->getLengthMode();
+        key.eqCoefficients = equalizer->getCoefficients();
+
+        return key;
     }
 
     //==============================================================================
     /**
-     * @brief Loads an impulse response from disk or IR bank
+     * @brief Loads the unprocessed impulse response from disk or IR bank
      *
-     * If given string is the name of an IR in IR bank, load that buffer. Otherwise,
-     * look for IR on disk.
+     * The IR is only replaced if it could be loaded.
      *
-     * @param [in] irName   Name or path of IR file
+     * @returns Loaded impulse response
      *
      * @throws std::invalid_argument
      */
     AudioBlock IRPipeline::reloadIR()
+    {
+        juce::AudioSampleBuffer loadedIR;
+        loadIR(loadedIR);
+
+        ir = std::move(loadedIR);
+
+        return AudioBlock(ir);
+    }
+
+    /**
+     * @brief Loads an impulse response from disk or IR bank into a given buffer
+     *
+     * If the IR name/path is the name of an IR in IR bank, load that buffer. Otherwise,
+     * look for IR on disk.
+     *
+     * @param [out] buffer  Loaded impulse response
+     *
+     * @throws std::invalid_argument
+     */
+    void IRPipeline::loadIR(juce::AudioSampleBuffer& buffer)
     {
         if (irNameOrFilePath.empty())
         {
@@ -199,19 +464,19 @@ namespace reverb
         }
 
         auto& irBank = IRBank::getInstance();
-        if (irBank.buffers.find(irNameOrFilePath) != irBank.buffers.end())
+        if (irBank.irs.find(irNameOrFilePath) != irBank.irs.end())
         {
-            loadIRFromBank(irNameOrFilePath);
+            loadIRFromBank(irNameOrFilePath, buffer);
         }
         else
         {
-            loadIRFromDisk(irNameOrFilePath);
+            loadIRFromDisk(irNameOrFilePath, buffer);
         }
 
-        AudioBlock irBlock(ir);
+        // One gain for all channels, so the balance between them (e.g. the paths of a
+        // true-stereo IR) is kept
+        AudioBlock irBlock(buffer);
         normalise(irBlock, MAX_IR_INTENSITY);
-
-        return irBlock;
     }
 
     //==============================================================================
@@ -221,29 +486,35 @@ namespace reverb
      * Loads the appropriate impulse response (IR) from binary data.
      *
      * @param [in] irName   Name of banked IR file
+     * @param [out] buffer  Loaded impulse response
      *
      * @throws std::invalid_argument
      */
-    void IRPipeline::loadIRFromBank(const std::string& irName)
+    void IRPipeline::loadIRFromBank(const std::string& irName, juce::AudioSampleBuffer& buffer)
     {
         auto& irBank = IRBank::getInstance();
 
         // Find requested IR
-        const auto irIter = irBank.buffers.find(irName);
-        const auto sampleRateIter = irBank.sampleRates.find(irName);
+        const AudioBlock irBlock = irBank.getBlock(irName);
 
-        if (irIter == irBank.buffers.end() ||
-            sampleRateIter == irBank.sampleRates.end())
-        {
-            throw std::invalid_argument("Requested impulse response (" + irName + ") does not exist in IR bank");
-        }
+        // Copy IR samples to internal representation (IRs with fewer channels than
+        // requested are repeated, e.g. mono IRs feed both stereo channels)
+        numSourceChannels = (int)irBlock.getNumChannels();
+        irSampleRate = irBank.irs.at(irName).sampleRate;
+        irVersion = 0;
+        loadedSampleRate = irSampleRate;
 
-        // Copy IR buffer to internal representation
-        ir.setSize(1, irIter->second.getNumSamples());
+        const int numIRChannels = getNumIRChannels();
+        const int numSamples = (int)irBlock.getNumSamples();
 
-        ir.copyFrom(0, 0,
-                    irIter->second.getReadPointer(channelIdx),
-                    irIter->second.getNumSamples());
+        buffer.setSize(numIRChannels, numSamples);
+
+        for (int channel = 0; channel < numIRChannels; ++channel)
+        {
+            buffer.copyFrom(channel, 0,
+                            irBlock.getChannelPointer((size_t)(channel % numSourceChannels)),
+                            numSamples);
+        }
     }
 
     //==============================================================================
@@ -251,31 +522,65 @@ namespace reverb
      * @brief Loads an impulse response from a file (.WAV or .AIFF) to internal representation
      *
      * Loads the selected impulse response (IR) from disk and splits it into individual buffers
-     * for each channel. This operation is potentially very heavy so processing is suspended
-     * until completion.
+     * for each channel. Decoding is potentially very heavy, so decoded files are shared
+     * through IRFileCache: the file is only read again if it changed. Long files are
+     * streamed straight into the IR buffer instead. If they aren't at the host rate,
+     * they are converted section by section as they are read, so the IR is never held
+     * in full at its native rate.
      *
      * @param [in] irFilePath   Path to impulse response file
+     * @param [out] buffer      Loaded impulse response
      *
      * @throws std::invalid_argument
      */
-    void IRPipeline::loadIRFromDisk(const std::string& irFilePath)
+    void IRPipeline::loadIRFromDisk(const std::string& irFilePath, juce::AudioSampleBuffer& buffer)
     {
-        // Load impulse response file
-        juce::File irFile(irFilePath);
+        // Load impulse response file (all channels, decoded once)
+        const IRFileCache::Source source = IRFileCache::getInstance().open(irFilePath);
+
+        // Keep the channels needed as internal representation
+        numSourceChannels = source.getNumChannels();
+        irSampleRate = source.getSampleRate();
+        irVersion = source.getModificationTime();
+
+        const int numIRChannels = getNumIRChannels();
+        const int numSamples = source.getNumSamples();
+
+        const bool isStreamed = (source.getDecodedIR() == nullptr);
 
-        juce::AudioFormatManager formatMgr;
-        formatMgr.registerBasicFormats();
+        if (!isStreamed || irSampleRate <= 0.0 || sampleRate <= 0.0 || irSampleRate == sampleRate)
+        {
+            buffer.setSize(numIRChannels, numSamples);
+            source.read(buffer);
+
+            loadedSampleRate = irSampleRate;
+            return;
+        }
+
+        const Resampler resampler(irSampleRate, sampleRate);
+        const int numDestSamples = resampler.getOutputNumSamples(numSamples);
+
+        buffer.setSize(numIRChannels, numDestSamples);
 
-        std::unique_ptr<juce::AudioFormatReader> reader(formatMgr.createReaderFor(irFile));
+        juce::AudioSampleBuffer section;
 
-        if (!reader)
+        for (int destStart = 0; destStart < numDestSamples; destStart += IRFileCache::CHUNK_NUM_SAMPLES)
         {
-            throw std::invalid_argument("Failed to create reader for IR file: " + irFilePath);
+            const juce::Range<int> destRange(destStart, std::min(destStart + IRFileCache::CHUNK_NUM_SAMPLES,
+                                                                 numDestSamples));
+            const juce::Range<int> sourceRange = resampler.getInputRange(destRange, numSamples);
+
+            section.setSize(numIRChannels, sourceRange.getLength(), false, false, true);
+            source.read(section, sourceRange.getStart(), sourceRange.getLength());
+
+            for (int channel = 0; channel < numIRChannels; ++channel)
+            {
+                resampler.process(section.getReadPointer(channel), sourceRange, numSamples,
+                                  buffer.getWritePointer(channel, destStart), destRange);
+            }
         }
 
-        // Read IR buffer into internal representation
-        ir.setSize(reader->numChannels, (int)reader->lengthInSamples);
-        reader->read(&ir, 0, (int)reader->lengthInSamples, 0, (channelIdx == 0), (channelIdx == 1));
+        loadedSampleRate = sampleRate;
     }
 
 }
@@ -11,12 +11,14 @@
 #include "Task.h"
 
 #include "Equalizer.h"
-#include "Gain.h"
 #include "IRBank.h"
-#include "PreDelay.h"
+#include "ProcessedIRCache.h"
+#include "Resampler.h"
 #include "TimeStretch.h"
 
 #include <array>
+#include <list>
+#include <memory>
 #include <mutex>
 #include <string>
 
@@ -29,12 +31,32 @@ namespace reverb
      * This pipeline is executed only as needed (i.e. when a new IR is requested or when one of
      * its parameters is changed). Therefore, it is not part of the critical path (its speed
      * does not have a huge impact on plugin performance).
+     *
+     * The output of each step is cached, so only the steps at or after the first one whose
+     * parameters changed are re-run (e.g. changing the IR length doesn't reload the IR).
+     * The EQ runs last, so EQ changes only re-filter the stretched IR.
+     *
+     * All IR channels go through the pipeline together, so the IR file is read, the EQ
+     * calibrated and the stretch ratio computed once, and the time stretch runs over all
+     * channels in a single pass.
+     *
+     * IRs are converted from their native sample rate to the host rate before being
+     * stretched. Converted IRs are cached per IR and host rate (within a memory budget),
+     * so switching back to an IR or rate used recently doesn't convert it again. The
+     * cache shares its buffers with the resample stage's output rather than copying them.
+     *
+     * Stage outputs are shared rather than copied from one stage to the next. Long IR
+     * files are converted to the host rate as they are read, so a long IR is only held
+     * once at full length: changing the host rate then reloads it.
+     *
+     * Fully processed IRs may also be kept across sessions in a ProcessedIRCache: the
+     * pipeline then only runs if the cache doesn't have the IR for current settings.
      */
     class IRPipeline : public Task
     {
     public:
         //==============================================================================
-        IRPipeline(juce::AudioProcessor * processor, int channelIdx);
+        IRPipeline(juce::AudioProcessor * processor);
 
         //==============================================================================
         using Ptr = std::shared_ptr<IRPipeline>;
@@ -54,28 +76,102 @@ namespace reverb
         //==============================================================================
         AudioBlock reloadIR();
 
+        void setNumChannels(int numChannels);
+        void setWorkerPool(WorkerPool* pool);
+        void setProcessedIRCache(ProcessedIRCache* cache);
+
+        int getNumSourceChannels() const { return numSourceChannels; }
+        int getNumIRChannels() const;
+
         static constexpr float MAX_IR_INTENSITY = 0.5f;
 
+        // IR channels for a stereo signal convolved in true stereo (L->L, L->R, R->L, R->R)
+        static constexpr int NUM_TRUE_STEREO_IR_CHANNELS = 4;
+
+        // Converted IRs kept around (least recently used ones are dropped, the most
+        // recently used one is always kept)
+        static constexpr size_t MAX_RESAMPLED_IR_BYTES = 32 * 1024 * 1024;
+
+        //==============================================================================
+        // Pipeline steps, in processing order
+        enum Stage
+        {
+            STAGE_LOAD,
+            STAGE_RESAMPLE,
+            STAGE_TIME_STRETCH,
+            STAGE_EQUALIZER,
+            NUM_STAGES
+        };
+
     protected:
+        //==============================================================================
+        // Stage outputs are read-only once computed, so they can be shared
+        using BufferPtr = std::shared_ptr<const juce::AudioSampleBuffer>;
+
+        //==============================================================================
+        int getFirstStageToRun() const;
+
+        BufferPtr resampleIR(const BufferPtr& buffer);
+
+        ProcessedIRCache::Key getProcessedIRKey() const;
+
         //==============================================================================
         Equalizer::Ptr equalizer;
         TimeStretch::Ptr timeStretch;
-        Gain::Ptr gain;
-        PreDelay::Ptr preDelay;
 
         //==============================================================================
         double lastSampleRate = 0;
 
         //==============================================================================
-        int channelIdx;
+        // Number of audio channels the IR is for
+        int numChannels = 1;
 
         //==============================================================================
         std::string irNameOrFilePath = "";
 
         juce::AudioSampleBuffer ir;
 
-        void loadIRFromBank(const std::string& irBuffer);
-        void loadIRFromDisk(const std::string& irFilePath);
+        // Output of each stage but the last one (which is ir). Only the first
+        // numStageOutputs are up to date.
+        std::array<BufferPtr, NUM_STAGES - 1> stageOutputs;
+        int numStageOutputs = 0;
+
+        // Number of channels in the IR file/resource
+        int numSourceChannels = 0;
+
+        // Native sample rate of the IR, and last modification time of its file (0 for
+        // banked IRs) so edited files aren't served from the resampled IR cache
+        double irSampleRate = 0.0;
+        juce::int64 irVersion = 0;
+
+        // Sample rate of the loaded IR: the native rate, or the host rate for long files
+        // converted while being read
+        double loadedSampleRate = 0.0;
+
+        // Set when the host rate changed: the IR must be converted again, not reloaded
+        bool mustResample = false;
+
+        //==============================================================================
+        struct ResampledIR
+        {
+            std::string irNameOrFilePath;
+            juce::int64 irVersion;
+            int numChannels;
+            double sampleRate;
+
+            BufferPtr buffer;
+        };
+
+        // Most recently used first
+        std::list<ResampledIR> resampledIRs;
+        size_t resampledIRsNumBytes = 0;
+
+        //==============================================================================
+        ProcessedIRCache* processedIRCache = nullptr;
+
+        void loadIR(juce::AudioSampleBuffer& buffer);
+        void loadIRFromBank(const std::string& irBuffer, juce::AudioSampleBuffer& buffer);
+        void loadIRFromDisk(const std::string& irFilePath, juce::AudioSampleBuffer& buffer);
     };
 
 }
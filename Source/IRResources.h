@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    IRResources.h
+
+    Generated by Resources/ImpulseResponses/generate_ir_resources.py
+    (do not edit)
+
+  ==============================================================================
+*/
+
+#pragma once
+
+namespace reverb
+{
+
+    namespace IRResources
+    {
+
+        struct Info
+        {
+            const char* name;
+            double sampleRate;
+            int numChannels;
+            int numSamples;
+
+            // Distance between the start of two channels in samples (channels are
+            // padded so each one is 16-byte aligned)
+            int channelStride;
+
+            // Start of the SHA-256 of the IR file (changes whenever the IR does)
+            const char* contentHash;
+        };
+
+        constexpr int NUM_IRS = 5;
+
+        constexpr Info infos[NUM_IRS] = {
+            { "large_church_wav", 48000.0, 2, 96000, 96000, "6cfe3f350a4076fa" },
+            { "large_hall_wav", 96000.0, 2, 556800, 556800, "7067e9dd04938cd3" },
+            { "medium_chamber_wav", 48000.0, 2, 230400, 230400, "af678607c26d6401" },
+            { "medium_hall_wav", 44100.0, 2, 264685, 264688, "75414f9e4ca34839" },
+            { "open_air_wav", 48000.0, 2, 69168, 69168, "908465d224dfeeaa" },
+        };
+
+        // Samples of each IR, channel after channel
+        extern const float* const samples[NUM_IRS];
+
+    }
+
+}
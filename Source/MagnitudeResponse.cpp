@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    MagnitudeResponse.cpp
+
+  ==============================================================================
+*/
+
+#include "MagnitudeResponse.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define REVERB_RESPONSE_SSE2 1
+#endif
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * @brief Tabulates the frequencies the response is evaluated at
+     *
+     * Allocates memory.
+     *
+     * @param [in] frequencies      Frequencies (in Hz)
+     * @param [in] numFrequencies   Number of frequencies
+     * @param [in] sampleRate       Sample rate the biquads run at
+     */
+    void MagnitudeResponse::prepare(const float* frequencies, int numFrequencies, double sampleRate)
+    {
+        jassert(sampleRate > 0.0);
+
+        phi.resize((size_t)numFrequencies);
+        phiSquared.resize((size_t)numFrequencies);
+
+        for (int i = 0; i < numFrequencies; ++i)
+        {
+            const double sinHalfOmega = std::sin(juce::MathConstants<double>::pi * frequencies[i] / sampleRate);
+
+            phi[i] = (float)(sinHalfOmega * sinHalfOmega);
+            phiSquared[i] = phi[i] * phi[i];
+        }
+
+        squaredMagnitudes.resize((size_t)numFrequencies);
+        totalSquaredMagnitudes.resize((size_t)numFrequencies);
+    }
+
+    //==============================================================================
+    /**
+     * @brief Evaluates the magnitude (in dB) of each band at each frequency
+     *
+     * @param [in]  bands           Coefficients of each band
+     * @param [in]  numBands        Number of bands
+     * @param [out] dBMagnitudes    Magnitude of band b at frequency f, at index
+     *                              (f * numBands + b), i.e. one row per frequency
+     */
+    void MagnitudeResponse::getdBMagnitudes(const float* const* bands, int numBands, float* dBMagnitudes)
+    {
+        const int numFrequencies = getNumFrequencies();
+
+        for (int b = 0; b < numBands; ++b)
+        {
+            getSquaredMagnitudes(bands[b], squaredMagnitudes.data());
+
+            for (int f = 0; f < numFrequencies; ++f)
+            {
+                dBMagnitudes[f * numBands + b] = 10.0f * std::log10(squaredMagnitudes[f]);
+            }
+        }
+    }
+
+    /**
+     * @brief Evaluates the magnitude (in dB) of all bands in cascade at each frequency
+     *
+     * Band magnitudes are multiplied together, so this takes a single logarithm per
+     * frequency.
+     *
+     * @param [in]  bands           Coefficients of each band
+     * @param [in]  numBands        Number of bands
+     * @param [out] dBMagnitudes    Magnitude of the cascade at each frequency
+     */
+    void MagnitudeResponse::getTotaldBMagnitudes(const float* const* bands, int numBands, float* dBMagnitudes)
+    {
+        const int numFrequencies = getNumFrequencies();
+
+        std::fill(totalSquaredMagnitudes.begin(), totalSquaredMagnitudes.end(), 1.0f);
+
+        for (int b = 0; b < numBands; ++b)
+        {
+            getSquaredMagnitudes(bands[b], squaredMagnitudes.data());
+
+            juce::FloatVectorOperations::multiply(totalSquaredMagnitudes.data(),
+                                                  squaredMagnitudes.data(), numFrequencies);
+        }
+
+        for (int f = 0; f < numFrequencies; ++f)
+        {
+            dBMagnitudes[f] = 10.0f * std::log10(totalSquaredMagnitudes[f]);
+        }
+    }
+
+    //==============================================================================
+    /**
+     * @brief Evaluates the squared magnitude of a band at each frequency
+     *
+     * With z = e^(jw) and phi = sin^2(w/2), |b0 + b1 z^-1 + b2 z^-2|^2 expands to
+     * (b0 + b1 + b2)^2 - 4 (b0 b1 + 4 b0 b2 + b1 b2) phi + 16 b0 b2 phi^2, and likewise
+     * for the denominator (with a0 = 1). Unlike the expansion in cos(w) and cos(2w), this
+     * doesn't cancel out at low frequencies, where the terms are nearly equal.
+     *
+     * @param [in]  band                Coefficients of the band
+     * @param [out] squaredMagnitudes   Squared magnitude at each frequency
+     */
+    void MagnitudeResponse::getSquaredMagnitudes(const float* band, float* squaredMagnitudes) const
+    {
+        const double b0 = band[0], b1 = band[1], b2 = band[2];
+        const double a1 = band[3], a2 = band[4];
+
+        const float num0 = (float)((b0 + b1 + b2) * (b0 + b1 + b2));
+        const float num1 = (float)(-4.0 * (b0 * b1 + 4.0 * b0 * b2 + b1 * b2));
+        const float num2 = (float)(16.0 * b0 * b2);
+
+        const float den0 = (float)((1.0 + a1 + a2) * (1.0 + a1 + a2));
+        const float den1 = (float)(-4.0 * (a1 + 4.0 * a2 + a1 * a2));
+        const float den2 = (float)(16.0 * a2);
+
+        const float* p1 = phi.data();
+        const float* p2 = phiSquared.data();
+        const int numFrequencies = getNumFrequencies();
+
+        int i = 0;
+
+#if REVERB_RESPONSE_SSE2
+        const __m128 n0 = _mm_set1_ps(num0), n1 = _mm_set1_ps(num1), n2 = _mm_set1_ps(num2);
+        const __m128 d0 = _mm_set1_ps(den0), d1 = _mm_set1_ps(den1), d2 = _mm_set1_ps(den2);
+
+        for (; i + 4 <= numFrequencies; i += 4)
+        {
+            const __m128 phi1 = _mm_loadu_ps(p1 + i);
+            const __m128 phi2 = _mm_loadu_ps(p2 + i);
+
+            const __m128 num = _mm_add_ps(n0, _mm_add_ps(_mm_mul_ps(n1, phi1), _mm_mul_ps(n2, phi2)));
+            const __m128 den = _mm_add_ps(d0, _mm_add_ps(_mm_mul_ps(d1, phi1), _mm_mul_ps(d2, phi2)));
+
+            _mm_storeu_ps(squaredMagnitudes + i, _mm_div_ps(num, den));
+        }
+#endif
+
+        for (; i < numFrequencies; ++i)
+        {
+            const float num = num0 + (num1 * p1[i] + num2 * p2[i]);
+            const float den = den0 + (den1 * p1[i] + den2 * p2[i]);
+
+            squaredMagnitudes[i] = num / den;
+        }
+    }
+
+}
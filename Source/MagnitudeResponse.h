@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    MagnitudeResponse.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#include <vector>
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * Evaluates the magnitude response of a set of biquads at a fixed set of frequencies.
+     *
+     * The squared magnitude of a biquad is a quadratic in sin^2(w/2), which is tabulated
+     * once per frequency in prepare(). Each band is then evaluated at all
+     * frequencies in a single vectorised pass, so calibrating an EQ or drawing its curve
+     * at many points costs no trigonometry or complex arithmetic.
+     *
+     * Bands are given as arrays of five coefficients (b0, b1, b2, a1, a2), normalised
+     * so that a0 = 1, as in juce::dsp::IIR::Coefficients.
+     */
+    class MagnitudeResponse
+    {
+    public:
+        //==============================================================================
+        MagnitudeResponse() = default;
+
+        //==============================================================================
+        void prepare(const float* frequencies, int numFrequencies, double sampleRate);
+
+        int getNumFrequencies() const { return (int)phi.size(); }
+
+        //==============================================================================
+        void getdBMagnitudes(const float* const* bands, int numBands, float* dBMagnitudes);
+        void getTotaldBMagnitudes(const float* const* bands, int numBands, float* dBMagnitudes);
+
+    private:
+        //==============================================================================
+        void getSquaredMagnitudes(const float* band, float* squaredMagnitudes) const;
+
+        //==============================================================================
+        // sin^2(w/2) and its square at each frequency
+        std::vector<float> phi;
+        std::vector<float> phiSquared;
+
+        std::vector<float> squaredMagnitudes;
+        std::vector<float> totalSquaredMagnitudes;
+    };
+
+}
@@ -27,6 +27,8 @@ namespace reverb
     {
         // Initialise pipeline steps
         convolution = std::make_shared<Convolution>(processor);
+        preDelay = std::make_shared<PreDelay>(processor);
+        irGain = std::make_shared<Gain>(processor);
         gain = std::make_shared<Gain>(processor);
         dryWetMixer = std::make_shared<Mixer>(processor);
     }
@@ -40,6 +42,8 @@ namespace reverb
     void MainPipeline::updateParams(const juce::AudioProcessorValueTreeState& params,
                                     const juce::String&)
     {
+        preDelay->updateParams(params, AudioProcessor::PID_PREDELAY);
+        irGain->updateParams(params, AudioProcessor::PID_IR_GAIN);
         gain->updateParams(params, AudioProcessor::PID_AUDIO_OUT_GAIN);
         dryWetMixer->updateParams(params, AudioProcessor::PID_WETRATIO);
     }
@@ -62,6 +66,9 @@ namespace reverb
             mustExec = true;
 
             convolution->updateSampleRate(sr);
+            convolution->setCrossfadeLength(juce::roundToInt(sr * AudioProcessor::IR_CROSSFADE_TIME_S));
+            preDelay->updateSampleRate(sr);
+            irGain->updateSampleRate(sr);
             gain->updateSampleRate(sr);
             dryWetMixer->updateSampleRate(sr);
         }
@@ -72,8 +79,9 @@ namespace reverb
      * @brief Apply reverb effect to given audio buffer
      *
      * Load original audio buffer into dryWetMixer object, then apply reverb pipeline
-     * steps in series (convolution w/ IR, dry/wet mixing and output attenuation). Output
-     * replaces samples in given audio buffer.
+     * steps in series (convolution w/ IR, predelay on the wet signal, then IR gain,
+     * dry/wet mixing and output attenuation in a single pass). Output replaces samples in given audio buffer. The buffer holds a
+     * single channel, or both stereo channels in true-stereo mode.
      *
      * @param [in,out] audio    Audio sample buffer
      */
@@ -82,12 +90,48 @@ namespace reverb
         dryWetMixer->loadDry(audio);
 
         convolution->exec(audio);
-        dryWetMixer->exec(audio);
-        gain->exec(audio);
+        preDelay->exec(audio);
+
+        // IR gain scales the wet signal (same as scaling the IR, without rebuilding it)
+        float irGainStart, irGainEnd;
+        irGain->getNextRamp(irGainStart, irGainEnd);
+
+        float outGainStart, outGainEnd;
+        gain->getNextRamp(outGainStart, outGainEnd);
+
+        dryWetMixer->exec(audio, outGainStart, outGainEnd, irGainStart, irGainEnd);
 
         return audio;
     }
 
+    //==============================================================================
+    /**
+     * @brief Prepare pipeline for a given maximum host block size
+     *
+     * Forwards the block size to the convolution step, which picks its partitioning
+     * (and thus latency) from it. If the partitioning changed, the current IR is
+     * reloaded into the convolution engine, unless its channel count no longer
+     * matches (the caller must then load a new IR). Also allocates the dry signal
+     * buffer and predelay line, so neither exec() nor updateSampleRate() have to.
+     *
+     * @param [in] maxBlockSize Maximum expected number of samples per block
+     * @param [in] sr           Sample rate
+     * @param [in] zeroLatency  True to run the convolution in zero-latency mode
+     * @param [in] trueStereo   True to process a stereo block with a 4-channel IR
+     */
+    void MainPipeline::prepare(int maxBlockSize, double sr, bool zeroLatency, bool trueStereo)
+    {
+        dryWetMixer->prepare(maxBlockSize);
+        preDelay->prepare(maxBlockSize, sr);
+
+        if (convolution->prepare(maxBlockSize, zeroLatency, trueStereo) &&
+            ir.getNumSamples() > 0 &&
+            (int)ir.getNumChannels() == convolution->getNumIRChannels())
+        {
+            convolution->loadIR(ir);
+        }
+    }
+
     //==============================================================================
     /**
      * @brief Copy reference to IR buffer
@@ -102,4 +146,61 @@ namespace reverb
 		convolution->loadIR(irIn);
     }
 
+    /**
+     * @brief Builds the convolution engine for a new IR without swapping it in
+     *
+     * Same as loadIR(), except the new IR only takes effect on the next publishIR()
+     * call. Pipelines are independent, so several of them can build their IRs
+     * concurrently. Must not be called from the audio thread.
+     *
+     * @param [in] irIn Input IR block
+     */
+    void MainPipeline::buildIR(AudioBlock irIn)
+    {
+        ir = irIn;
+        convolution->buildIR(irIn);
+    }
+
+    /**
+     * @brief Swaps in the IR built by buildIR(), if any
+     *
+     * Only swaps pointers (replaced IRs are freed by releaseRetiredIRs()), so it can be
+     * called for all channels while holding the callback lock, making a new IR take
+     * effect on all channels at once.
+     *
+     * @returns True if a new IR was swapped in
+     */
+    bool MainPipeline::publishIR()
+    {
+        return convolution->publishIR();
+    }
+
+    /**
+     * @brief Returns the delay (in samples) introduced by the pipeline
+     */
+    int MainPipeline::getLatencySamples() const
+    {
+        return convolution->getLatencySamples();
+    }
+
+    /**
+     * @brief Returns the total time (in seconds of audio) spent crossfading between IRs
+     *
+     * During a crossfade, the convolution runs both the previous and the new IR.
+     */
+    double MainPipeline::getCrossfadeTime() const
+    {
+        return sampleRate > 0.0 ? convolution->getNumCrossfadeSamples() / sampleRate : 0.0;
+    }
+
+    /**
+     * @brief Frees IRs replaced since the last call, once the convolution is done with them
+     *
+     * Must not be called from the audio thread.
+     */
+    void MainPipeline::releaseRetiredIRs()
+    {
+        convolution->collectRetiredEngines();
+    }
+
 }
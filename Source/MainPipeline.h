@@ -13,6 +13,7 @@
 #include "Convolution.h"
 #include "Gain.h"
 #include "Mixer.h"
+#include "PreDelay.h"
 
 namespace reverb
 {
@@ -52,13 +53,24 @@ namespace reverb
         virtual bool needsToRun() const override { return true; }
 
         //==============================================================================
+        void prepare(int maxBlockSize, double sr, bool zeroLatency = false, bool trueStereo = false);
         void loadIR(AudioBlock irIn);
 
+        void buildIR(AudioBlock irIn);
+        bool publishIR();
+
+        int getLatencySamples() const;
+        double getCrossfadeTime() const;
+
+        void releaseRetiredIRs();
+
         AudioBlock ir;
 
     protected:
         //==============================================================================
         Convolution::Ptr convolution;
+        PreDelay::Ptr preDelay;
+        Gain::Ptr irGain;
         Gain::Ptr gain;
         Mixer::Ptr dryWetMixer;
     };
@@ -12,6 +12,13 @@
 
 #include "Logger.h"
 
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define REVERB_MIX_SSE2 1
+#endif
+
 namespace reverb
 {
 
@@ -57,8 +64,42 @@ namespace reverb
      */
     AudioBlock Mixer::exec(AudioBlock wetAudio)
     {
-        wetAudio.multiply(wetRatio);
-        wetAudio.addWithMultiply(dryAudioCopy, 1 - wetRatio);
+        return exec(wetAudio, 1.0f, 1.0f);
+    }
+
+    /**
+     * @brief Mix the wet and dry sound, then apply an output gain, in a single pass
+     *
+     * Computes out = (wet * v * w + dry * (1 - w)) * g. If the wet ratio w changed
+     * since the last block, it is ramped from its previous value over this block. The
+     * output gain g and wet gain v are ramped between the given values.
+     *
+     * @param [in,out] wetAudio     Buffer containing the wet audio signal
+     * @param [in]     outGainStart Output gain at the start of the block
+     * @param [in]     outGainEnd   Output gain at the end of the block
+     * @param [in]     wetGainStart Wet signal gain at the start of the block
+     * @param [in]     wetGainEnd   Wet signal gain at the end of the block
+     */
+    AudioBlock Mixer::exec(AudioBlock wetAudio, float outGainStart, float outGainEnd,
+                           float wetGainStart, float wetGainEnd)
+    {
+        const float wetRatioStart = hasAppliedWetRatio ? appliedWetRatio : wetRatio;
+
+        const int numChannels = std::min((int)wetAudio.getNumChannels(),
+                                         dryAudioCopy.getNumChannels());
+
+        for (int i = 0; i < numChannels; ++i)
+        {
+            float* out = wetAudio.getChannelPointer(i);
+
+            mix(out, out, dryAudioCopy.getReadPointer(i),
+                wetRatioStart * wetGainStart * outGainStart, wetRatio * wetGainEnd * outGainEnd,
+                (1 - wetRatioStart) * outGainStart, (1 - wetRatio) * outGainEnd,
+                (int)wetAudio.getNumSamples());
+        }
+
+        appliedWetRatio = wetRatio;
+        hasAppliedWetRatio = true;
 
         // Reset mustExec flag
         mustExec = false;
@@ -67,19 +108,100 @@ namespace reverb
     }
 
     //==============================================================================
+    /**
+    * @brief Allocates the dry signal buffer for a given maximum block size
+    *
+    * Does nothing if the buffer is already large enough, so it is safe to call again
+    * with the same block size while audio is being processed.
+    *
+    * @param [in] maxBlockSize  Maximum expected number of samples per block
+    */
+    void Mixer::prepare(int maxBlockSize)
+    {
+        if (maxBlockSize <= maxNumSamples)
+        {
+            return;
+        }
+
+        maxNumSamples = maxBlockSize;
+        dryAudioCopy.setSize(MAX_NUM_CHANNELS, maxNumSamples);
+    }
+
     /**
     * @brief loads the dry signal into the dryAudio variable
     *
-    * @param [in,out] dryAudio Buffer containing the dry signal
+    * Never allocates for blocks up to the size given to prepare().
+    *
+    * @param [in,out] dryAudio Buffer containing the dry signal (one or more channels)
     */
     void Mixer::loadDry(AudioBlock dryAudio)
     {
-		dryAudioCopy.clear();
-        dryAudioCopy.setSize(1, (int)dryAudio.getNumSamples());
+        dryAudioCopy.setSize((int)dryAudio.getNumChannels(), (int)dryAudio.getNumSamples(),
+                             false, false, true);
+
+        for (int i = 0; i < (int)dryAudio.getNumChannels(); ++i)
+        {
+            dryAudioCopy.copyFrom(i, 0,
+                                  dryAudio.getChannelPointer(i),
+                                  (int)dryAudio.getNumSamples());
+        }
+    }
+
+    //==============================================================================
+    /**
+    * @brief Fused dry/wet mixing kernel with linear gain ramps
+    *
+    * Computes out[i] = wet[i] * a[i] + dry[i] * b[i], where gains a and b ramp
+    * linearly from their start values, reaching their end values at the start of the
+    * next block. out may be the same buffer as wet.
+    *
+    * @param [out] out          Output samples
+    * @param [in]  wet          Wet samples
+    * @param [in]  dry          Dry samples
+    * @param [in]  wetGainStart Gain a at the first sample
+    * @param [in]  wetGainEnd   Gain a after the last sample
+    * @param [in]  dryGainStart Gain b at the first sample
+    * @param [in]  dryGainEnd   Gain b after the last sample
+    * @param [in]  numSamples   Number of samples
+    */
+    void Mixer::mix(float* out, const float* wet, const float* dry,
+                    float wetGainStart, float wetGainEnd,
+                    float dryGainStart, float dryGainEnd,
+                    int numSamples)
+    {
+        if (numSamples <= 0)
+        {
+            return;
+        }
+
+        const float wetGainStep = (wetGainEnd - wetGainStart) / numSamples;
+        const float dryGainStep = (dryGainEnd - dryGainStart) / numSamples;
+
+        int i = 0;
+
+#if REVERB_MIX_SSE2
+        const __m128 offsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        const __m128 wetSteps = _mm_set1_ps(wetGainStep);
+        const __m128 drySteps = _mm_set1_ps(dryGainStep);
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            const __m128 idx = _mm_add_ps(_mm_set1_ps((float)i), offsets);
+            const __m128 wetGain = _mm_add_ps(_mm_set1_ps(wetGainStart), _mm_mul_ps(idx, wetSteps));
+            const __m128 dryGain = _mm_add_ps(_mm_set1_ps(dryGainStart), _mm_mul_ps(idx, drySteps));
+
+            const __m128 result = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(wet + i), wetGain),
+                                             _mm_mul_ps(_mm_loadu_ps(dry + i), dryGain));
+
+            _mm_storeu_ps(out + i, result);
+        }
+#endif
 
-        dryAudioCopy.copyFrom(0, 0,
-                              dryAudio.getChannelPointer(0),
-                              (int)dryAudio.getNumSamples());
+        for (; i < numSamples; ++i)
+        {
+            out[i] = wet[i] * (wetGainStart + i * wetGainStep) +
+                     dry[i] * (dryGainStart + i * dryGainStep);
+        }
     }
 
 }
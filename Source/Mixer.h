@@ -16,6 +16,10 @@ namespace reverb
     //==============================================================================
     /**
     * Class used to mix dry sound with wet sound after convolution.
+    *
+    * The dry/wet mix and the output gain are applied in a single pass over the
+    * buffer, and both are ramped over a block when they change so automation does
+    * not click.
     */
     class Mixer : public Task
     {
@@ -32,17 +36,32 @@ namespace reverb
                                   const juce::String& blockId) override;
 
         virtual AudioBlock exec(AudioBlock wetAudio) override;
+        AudioBlock exec(AudioBlock wetAudio, float outGainStart, float outGainEnd,
+                        float wetGainStart = 1.0f, float wetGainEnd = 1.0f);
 
         //==============================================================================
+        void prepare(int maxBlockSize);
         void loadDry(AudioBlock audio);
 
+        //==============================================================================
+        static void mix(float* out, const float* wet, const float* dry,
+                        float wetGainStart, float wetGainEnd,
+                        float dryGainStart, float dryGainEnd,
+                        int numSamples);
+
+        static constexpr int MAX_NUM_CHANNELS = 2;
+
     protected:
         //==============================================================================
         juce::AudioSampleBuffer dryAudioCopy;
-
+        int maxNumSamples = 0;
 
         //==============================================================================
         float wetRatio = 0.0f;
+
+        // Ratio reached at the end of the last block (start of the next ramp)
+        float appliedWetRatio = 0.0f;
+        bool hasAppliedWetRatio = false;
     };
 
 }
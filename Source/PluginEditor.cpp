@@ -182,7 +182,7 @@ namespace reverb
 
             m.addSeparator();
 
-            for (auto irFile : IRBank::getInstance().buffers)
+            for (const auto& irFile : IRBank::getInstance().irs)
             {
                 m.addItem(m.getNumItems() + 1, irFile.first);
             }
@@ -232,7 +232,7 @@ namespace reverb
             }
             else
             {
-                selectedIR = std::next(IRBank::getInstance().buffers.begin(),
+                selectedIR = std::next(IRBank::getInstance().irs.begin(),
                     result - headerBlock->previousSelectedIRs.size() - 2)->first;
                 irName.setProperty("value", selectedIR, nullptr);
                 headerBlock->irChoice.setButtonText(selectedIR);
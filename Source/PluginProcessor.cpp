@@ -16,7 +16,7 @@
 #include <windows.h>
 #endif
 
-#include <thread>
+#include <algorithm>
 
 namespace reverb
 {
@@ -39,11 +39,16 @@ namespace reverb
 #endif
 	{
         initParams();
+
+        backgroundWorker.reset(new BackgroundWorker(
+            [this](const BackgroundWorker::Command& command) { runBackgroundCommand(command); },
+            NUM_BACKGROUND_COMMANDS));
 	}
 
 	AudioProcessor::~AudioProcessor()
 	{
-        std::lock_guard<std::mutex> lock(updatingParams);
+        // Stop background work before pipelines are destroyed
+        backgroundWorker.reset();
 	}
 
 	//==============================================================================
@@ -128,7 +133,7 @@ namespace reverb
      * @param sampleRate [in]       Target sample rate (constant until playback stops)
      * @param samplesPerBlock [in]  Hint about max. expected samples in upcoming block
      */
-    void AudioProcessor::prepareToPlay(double sampleRate, int)
+    void AudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
     {
         size_t numChannels = getTotalNumInputChannels();
 
@@ -145,15 +150,13 @@ namespace reverb
             logger.dualPrint(Logger::Level::Error, errMsg);
         }
 
-        // Add/remove pipelines as needed to meet requested number of channels
-        for (size_t i = numChannels; i < irPipelines.size(); ++i)
-        {
-            irPipelines.pop_back();
-        }
-
-        for (size_t i = irPipelines.size(); i < numChannels; ++i)
+        // Add/remove pipelines as needed to meet requested number of channels. A single
+        // IR pipeline processes the IR for all of them.
+        if (!irPipeline)
         {
-            irPipelines.emplace_back(new IRPipeline(this, (int)i));
+            irPipeline.reset(new IRPipeline(this));
+            irPipeline->setWorkerPool(backgroundPool);
+            irPipeline->setProcessedIRCache(processedIRCache);
         }
 
         for (size_t i = numChannels; i < mainPipelines.size(); ++i)
@@ -166,6 +169,38 @@ namespace reverb
             mainPipelines.emplace_back(new MainPipeline(this));
         }
 
+        // Partition convolutions for the host block size and report resulting latency
+        // (none in zero-latency mode)
+        {
+            std::lock_guard<std::mutex> lock(updatingParams);
+
+            trueStereo = trueStereo && (numChannels == 2);
+
+            for (size_t i = 0; i < mainPipelines.size(); ++i)
+            {
+                mainPipelines[i]->prepare(samplesPerBlock, sampleRate, ZERO_LATENCY_CONVOLUTION,
+                                          trueStereo && (i == 0));
+            }
+        }
+
+        setLatencySamples(mainPipelines.empty() ? 0 : mainPipelines[0]->getLatencySamples());
+
+#if REVERB_MULTITHREADED > 0
+        // Start channel workers (the audio thread processes one channel itself)
+        const int numWorkers = std::max((int)numChannels - 1, 0);
+
+        if (!workerPool || workerPool->getNumWorkers() != numWorkers)
+        {
+            workerPool.reset(new WorkerPool(numWorkers));
+        }
+
+        // Keep workers spinning between callbacks, so they only park once playback stops
+        if (sampleRate > 0.0)
+        {
+            workerPool->setSpinTime(WORKER_SPIN_NUM_CALLBACKS * samplesPerBlock / sampleRate);
+        }
+#endif
+
         // Update parameters across pipelines
         updateParams(sampleRate);
     }
@@ -174,9 +209,11 @@ namespace reverb
      * @brief Release resource when playback stops
      *
      * Used when playback stops as an opportunity to free up any spare memory, etc.
+     * Stops the channel worker threads.
      */
 	void AudioProcessor::releaseResources()
 	{
+        workerPool.reset();
 	}
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -243,59 +280,54 @@ namespace reverb
         // We should have the right number of pipelines and channel buffers from
         // a previous call to prepareToPlay(), but just to be safe let's check
         // these values here.
-        for (size_t i = irPipelines.size(); i < totalNumInputChannels; ++i)
+        if (!irPipeline)
         {
-            irPipelines.emplace_back(new IRPipeline(this, (int)i));
+            irPipeline.reset(new IRPipeline(this));
+            irPipeline->setWorkerPool(backgroundPool);
+            irPipeline->setProcessedIRCache(processedIRCache);
         }
 
         for (size_t i = mainPipelines.size(); i < totalNumInputChannels; ++i)
         {
             mainPipelines.emplace_back(new MainPipeline(this));
+            mainPipelines.back()->prepare(getBlockSize(), getSampleRate(), ZERO_LATENCY_CONVOLUTION);
         }
 
         // Associate audio block with input
         audioChannels = audio;
 
-        // Update parameters asynchronously
-        if (blocksProcessed % NUM_BLOCKS_PER_UPDATE_PARAMS)
+        // Update parameters asynchronously. Posting is lock-free; if an update is
+        // already queued or running, the background worker collapses the requests.
+        if (blocksProcessed % NUM_BLOCKS_PER_UPDATE_PARAMS == 0)
         {
-            std::unique_lock<std::mutex> lock(updatingParams, std::try_to_lock);
+            BackgroundWorker::Command command;
+            command.target = CMD_UPDATE_PARAMS;
+            command.value = getSampleRate();
 
-            // If parameters are already being updated, skip this and go straight
-            // to processing.
-            if (lock.owns_lock())
-            {
-                std::thread updateParamsThread(&AudioProcessor::updateParams,
-                                               this, getSampleRate());
-
-                lock.unlock();
-
-                // updateParams() uses double buffering to update everything
-                // asynchronously, so we can let it do its own thing.
-                updateParamsThread.detach();
-            }
+            backgroundWorker->post(command);
         }
 
-#if REVERB_MULTITHREADED > 0
-        // Process each channel in its own thread
-        std::vector<std::thread> channelThreads;
-
-        for (int i = 0; i < totalNumInputChannels; ++i)
-        {
-            channelThreads.emplace_back(&AudioProcessor::processChannel, this, i);
-        }
-
-        // Wait for each thread to complete
-        for (int i = 0; i < channelThreads.size(); ++i)
+        if (trueStereo)
         {
-            channelThreads[i].join();
+            // Both channels go through a single pipeline, which shares each input
+            // channel's spectrum between both output channels
+            mainPipelines[0]->exec(audioChannels);
         }
-#else
-        for (int i = 0; i < totalNumInputChannels; ++i)
+        else
         {
-            processChannel(i);
+            if (workerPool)
+            {
+                // Process channels in parallel on persistent worker threads
+                workerPool->run(totalNumInputChannels, &AudioProcessor::processChannelJob, this);
+            }
+            else
+            {
+                for (int i = 0; i < totalNumInputChannels; ++i)
+                {
+                    processChannel(i);
+                }
+            }
         }
-#endif
 
         blocksProcessed++;
 
@@ -312,18 +344,19 @@ namespace reverb
      */
     void AudioProcessor::processChannel(int channelIdx)
     {
-#ifdef WIN32
-        SetThreadPriority(GetCurrentThread(),
-                          THREAD_PRIORITY_TIME_CRITICAL);
-#endif
-
         AudioBlock channelAudio = audioChannels.getSingleChannelBlock(channelIdx);
         mainPipelines[channelIdx]->exec(channelAudio);
+    }
 
-#ifdef WIN32
-        SetThreadPriority(GetCurrentThread(),
-                          THREAD_PRIORITY_NORMAL);
-#endif
+    /**
+     * @brief WorkerPool job wrapper around processChannel()
+     *
+     * @param [in] processor    Pointer to AudioProcessor
+     * @param [in] channelIdx   Index of channel to process
+     */
+    void AudioProcessor::processChannelJob(void* processor, int channelIdx)
+    {
+        static_cast<AudioProcessor*>(processor)->processChannel(channelIdx);
     }
 
     //==============================================================================
@@ -349,14 +382,107 @@ namespace reverb
         std::lock_guard<std::mutex> lock(updatingParams);
 
         // Check number of channels
-        const int numChannels = (int)irPipelines.size();
-        
-        jassert(mainPipelines.size() == numChannels);
+        const int numChannels = (int)mainPipelines.size();
+
+        jassert(irPipeline != nullptr);
+
+        // Reprocess IR if necessary. All channels are processed together, so the IR is
+        // loaded, stretched and filtered once. A stereo bus gets all four channels of a true-stereo
+        // IR (L->L, L->R, R->L, R->R).
+        bool irUpdated = updateIR(numChannels, sampleRate);
 
-        // Process parameters for each channel
-        for (int i = 0; i < numChannels; ++i)
+        const bool useTrueStereo = (numChannels == 2) &&
+                                   (ir.getNumChannels() == NUM_TRUE_STEREO_IR_CHANNELS);
+
+        // Update main parameters (short critical section: main pipelines are used by
+        // processBlock)
         {
-            updateParamsForChannel(i, sampleRate);
+            juce::ScopedLock lock(getCallbackLock());
+
+            for (auto& mainPipeline : mainPipelines)
+            {
+                mainPipeline->updateParams(parameters);
+                mainPipeline->updateSampleRate(sampleRate);
+            }
+        }
+
+        // Load IRs without locking: convolution engines are built here and only published
+        // (a few pointer swaps) under the lock, so processBlock never waits for them
+        // to be built. A convolution engine copes
+        // with blocks having more channels than it needs, so when switching to
+        // true-stereo mode, the stereo block is routed to the first pipeline before
+        // its engine gets the extra inputs, and the other way around when switching
+        // back.
+        if (useTrueStereo != trueStereo)
+        {
+            if (useTrueStereo)
+            {
+                trueStereo = true;
+            }
+
+            mainPipelines[0]->prepare(getBlockSize(), sampleRate, ZERO_LATENCY_CONVOLUTION, useTrueStereo);
+
+            irUpdated = true;
+        }
+
+        irBuildJobs.clear();
+
+        if (useTrueStereo)
+        {
+            if (irUpdated)
+            {
+                IRBuildJob job;
+                job.pipeline = mainPipelines[0].get();
+                job.ir = ir;
+
+                irBuildJobs.push_back(job);
+            }
+        }
+        else
+        {
+            for (int i = 0; i < numChannels; ++i)
+            {
+                const bool loadChannel = irUpdated && i < (int)ir.getNumChannels() &&
+                                         ir.getNumSamples() > 0;
+
+                if (loadChannel)
+                {
+                    IRBuildJob job;
+                    job.pipeline = mainPipelines[i].get();
+                    job.ir = ir.getSingleChannelBlock(i);
+
+                    irBuildJobs.push_back(job);
+                }
+            }
+        }
+
+        // Build all channels in parallel (this thread helps out and returns once all of
+        // them are done), then swap them in together so channels never play different IRs
+        backgroundPool->run((int)irBuildJobs.size(), &AudioProcessor::runIRBuildJob, this);
+
+        for (const auto& job : irBuildJobs)
+        {
+            if (job.error)
+            {
+                std::rethrow_exception(job.error);
+            }
+        }
+
+        {
+            juce::ScopedLock lock(getCallbackLock());
+
+            for (const auto& job : irBuildJobs)
+            {
+                job.pipeline->publishIR();
+            }
+        }
+
+        trueStereo = useTrueStereo;
+
+        // IRs replaced by the previous update are usually done crossfading by now
+        for (auto& mainPipeline : mainPipelines)
+        {
+            mainPipeline->releaseRetiredIRs();
         }
 
 #ifdef WIN32
@@ -366,50 +492,74 @@ namespace reverb
     }
 
     /**
-     * @brief Update parameters for a given channel
+     * @brief Update IR parameters for all channels
      *
-     * Update parameters in IRPipeline and Mainpipeline for given channel. If
-     * necessary, reprocess IR using new parameters and copy to MainPipeline.
+     * Update parameters in IRPipeline and, if necessary, reprocess IR using new
+     * parameters. The processed IR is kept in ir.
      *
-     * MainPipeline is double-buffered to avoid interfering with processChannel().
      * IRPipeline is not used by any other methods, so it does not need protection.
      *
-     * @param [in] channelIdx   Channel parameters should be updated for
+     * @param [in] numChannels  Number of audio channels the IR is for
      * @param [in] sampleRate   Current sample rate
+     *
+     * @returns True if the IR was reprocessed
      */
-    void AudioProcessor::updateParamsForChannel(int channelIdx, double sampleRate)
+    bool AudioProcessor::updateIR(int numChannels, double sampleRate)
     {
-        auto& processorLock = getCallbackLock();
-
-        auto& irPipeline = irPipelines[channelIdx];
-        auto& mainPipeline = mainPipelines[channelIdx];
-
-        AudioBlock irChannel;
-
         // Update IR parameters
+        irPipeline->setNumChannels(std::max(numChannels, 1));
         irPipeline->updateSampleRate(sampleRate);
         irPipeline->updateParams(parameters);
 
         // Reprocess IR if necessary
-        bool updateIR = irPipeline->needsToRun();
-
-        if (updateIR)
+        if (!irPipeline->needsToRun())
         {
-            irChannel = irPipeline->exec();
+            return false;
         }
 
-        // Update main parameters (critical section: mainPipeline is used by
-        // processChannel)
+        ir = irPipeline->exec();
+
+        return true;
+    }
+
+    /**
+     * @brief Builds the convolution engine for one IR build job (on the background pool)
+     *
+     * Exceptions are kept in the job, since they can't cross worker threads.
+     *
+     * @param [in] processor    Pointer to processor
+     * @param [in] jobIdx       Index of job in irBuildJobs
+     */
+    void AudioProcessor::runIRBuildJob(void* processor, int jobIdx)
+    {
+        auto& job = static_cast<AudioProcessor*>(processor)->irBuildJobs[jobIdx];
+
+        try
+        {
+            job.pipeline->buildIR(job.ir);
+        }
+        catch (...)
         {
-            juce::ScopedLock lock(processorLock);
+            job.error = std::current_exception();
+        }
+    }
 
-            mainPipeline->updateParams(parameters);
-            mainPipeline->updateSampleRate(sampleRate);
+    /**
+     * @brief Runs a command posted by the audio thread (on the background worker)
+     *
+     * @param [in] command  Command to run
+     */
+    void AudioProcessor::runBackgroundCommand(const BackgroundWorker::Command& command)
+    {
+        switch (command.target)
+        {
+        case CMD_UPDATE_PARAMS:
+            updateParams(command.value);
+            break;
 
-            if (updateIR)
-            {
-                mainPipeline->loadIR(irChannel);
-            }
+        default:
+            jassertfalse;
+            break;
         }
     }
 
@@ -471,6 +621,23 @@ namespace reverb
         }
 	}
 
+    //==============================================================================
+    /**
+     * @brief Sets the cache processed IRs are fetched from and stored to
+     *
+     * By default, instances share a cache in the user's application data directory.
+     * Must be called before prepareToPlay() (e.g. so tests can use a temporary
+     * directory).
+     *
+     * @param [in] cache    Processed IR cache (null to disable), must outlive the processor
+     */
+    void AudioProcessor::setProcessedIRCache(ProcessedIRCache* cache)
+    {
+        jassert(!irPipeline);
+
+        processedIRCache = cache;
+    }
+
     //==============================================================================
     void AudioProcessor::initParams()
     {
@@ -596,6 +763,12 @@ namespace reverb
                                           3.0f,
                                           nullptr, nullptr);
 
+        parameters.createAndAddParameter( PID_IR_LENGTH_MODE,
+                                          "Reverb length mode", "<0 = time stretch, 1 = decay envelope>",
+                                          juce::NormalisableRange<float>(0.0f, 1.0f, 1.0f),
+                                          0.0f,
+                                          nullptr, nullptr );
+
         /**
          * Pre-delay
          */
@@ -642,15 +815,15 @@ namespace reverb
          * Impulse responses
          * 
          * IR file choice is given by a string that may be one of the following:
-         *     1) name of a valid audio resource in BinaryData.h
+         *     1) name of a banked IR (see IRResources.h)
          *     2) full path to user-provided IR file
          */
         juce::ValueTree irFile(PID_IR_FILE_CHOICE);
 
         auto& irBank = IRBank::getInstance();
-        if (irBank.buffers.begin() != irBank.buffers.end())
+        if (irBank.irs.begin() != irBank.irs.end())
         {
-            const juce::String& firstBankedIR = irBank.buffers.begin()->first;
+            const juce::String& firstBankedIR = irBank.irs.begin()->first;
             irFile.setProperty("value", firstBankedIR, nullptr);
         }
 
@@ -12,10 +12,14 @@
 
 #include "JuceHeader.h"
 
+#include "BackgroundWorker.h"
 #include "IRBank.h"
 #include "IRPipeline.h"
 #include "MainPipeline.h"
+#include "WorkerPool.h"
 
+#include <atomic>
+#include <exception>
 #include <map>
 #include <mutex>
 #include <vector>
@@ -70,6 +74,9 @@ namespace reverb
 		void getStateInformation(juce::MemoryBlock& destData) override;
 		void setStateInformation(const void* data, int sizeInBytes) override;
 
+        //==============================================================================
+        void setProcessedIRCache(ProcessedIRCache* cache);
+
         //==============================================================================
         juce::AudioProcessorValueTreeState parameters;
         
@@ -78,6 +85,7 @@ namespace reverb
 
         static constexpr const char * PID_IR_FILE_CHOICE     = "ir_file_choice";
         static constexpr const char * PID_IR_LENGTH          = "ir_length";
+        static constexpr const char * PID_IR_LENGTH_MODE     = "ir_length_mode";
 
         static constexpr const char * PID_FILTER_PREFIX      = "filter";
         static constexpr const char * PID_FILTER_FREQ_SUFFIX = "_freq";
@@ -89,8 +97,12 @@ namespace reverb
         static constexpr const char * PID_WETRATIO           = "wetratio";
         static constexpr const char * PID_AUDIO_OUT_GAIN     = "audio_out_gain";
 
+        // Length of the crossfade from the previous to the new IR (avoids clicks)
+        static constexpr double IR_CROSSFADE_TIME_S = 0.05;
+
         //==============================================================================
-        std::vector<IRPipeline::Ptr>   irPipelines;
+        // Single IR pipeline processing the IR for all channels at once
+        IRPipeline::Ptr                irPipeline;
         std::vector<MainPipeline::Ptr> mainPipelines;
 
         std::mutex updatingParams;
@@ -103,16 +115,73 @@ namespace reverb
 
         //==============================================================================
         static constexpr int NUM_BLOCKS_PER_UPDATE_PARAMS = 5;
+
+        // Run convolution head as a direct-form FIR so the plugin adds no latency
+        static constexpr bool ZERO_LATENCY_CONVOLUTION = true;
         int64_t blocksProcessed = 0;
 
         void updateParams(double sampleRate);
-        void updateParamsForChannel(int channelIdx, double sampleRate);
+        bool updateIR(int numChannels, double sampleRate);
+
+        //==============================================================================
+        // Work posted by the audio thread and run on the background worker
+        enum BackgroundCommand
+        {
+            CMD_UPDATE_PARAMS,
+            NUM_BACKGROUND_COMMANDS
+        };
+
+        void runBackgroundCommand(const BackgroundWorker::Command& command);
+
+        std::unique_ptr<BackgroundWorker> backgroundWorker;
+
+        //==============================================================================
+        // Stereo buses use true-stereo convolution (single 2x2 main pipeline) when the
+        // selected IR has 4 channels (L->L, L->R, R->L, R->R)
+        static constexpr int NUM_TRUE_STEREO_IR_CHANNELS = IRPipeline::NUM_TRUE_STEREO_IR_CHANNELS;
+
+        std::atomic<bool> trueStereo { false };
+
+        // Processed IR (one channel per main pipeline, or a true-stereo IR)
+        AudioBlock ir;
+
+        //==============================================================================
+        // Convolution engine builds for a parameter update, one per main pipeline. They
+        // run in parallel and are swapped in together once all of them are done.
+        struct IRBuildJob
+        {
+            MainPipeline* pipeline = nullptr;
+            AudioBlock ir;
+            std::exception_ptr error;
+        };
+
+        static void runIRBuildJob(void* processor, int jobIdx);
+
+        std::vector<IRBuildJob> irBuildJobs;
+
+        // Threads helping the background worker with IR processing and builds, shared by
+        // all instances (a single pool, so several instances updating at once don't
+        // oversubscribe the cores)
+        juce::SharedResourcePointer<BackgroundWorkerPool> sharedBackgroundPool;
+        BackgroundWorkerPool* backgroundPool = &sharedBackgroundPool.getObject();
+
+        // Processed IRs on disk, shared by all instances (its writer thread stops with the
+        // last one), unless another cache was set
+        juce::SharedResourcePointer<ProcessedIRCache> sharedProcessedIRCache;
+        ProcessedIRCache* processedIRCache = &sharedProcessedIRCache.getObject();
 
         //==============================================================================
         void processChannel(int channelIdx);
+        static void processChannelJob(void* processor, int channelIdx);
 
         AudioBlock audioChannels;
 
+        // Channel jobs run on the audio thread plus (numChannels - 1) persistent workers
+        std::unique_ptr<WorkerPool> workerPool;
+
+        // Callback periods idle workers spin for before parking
+        static constexpr double WORKER_SPIN_NUM_CALLBACKS = 1.5;
+
 	private:
 		//==============================================================================
 		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioProcessor)
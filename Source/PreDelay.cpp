@@ -26,6 +26,9 @@ namespace reverb
     PreDelay::PreDelay(juce::AudioProcessor * processor)
         : Task(processor)
     {
+        // Delay line is only allocated by prepare(), which knows both sample rate and
+        // block size
+        sampleRate = 0.0;
     }
 
     /**
@@ -45,59 +48,186 @@ namespace reverb
             mustExec = true;
         }
     }
-    
+
+    /**
+     * @brief Update sample rate
+     *
+     * Never allocates, since it is called while audio processing is locked out: the
+     * delay line is sized by prepare(). Delays longer than it holds at the new rate (if
+     * it wasn't prepared for it) are shortened to the longest it holds.
+     *
+     * @param [in] sr   Sample rate
+     */
+    void PreDelay::updateSampleRate(double sr)
+    {
+        if (sr != sampleRate)
+        {
+            sampleRate = sr;
+            mustExec = true;
+        }
+    }
+
     //==============================================================================
     /**
-     * @brief Applies predelay to impulse response
+     * @brief Allocates an empty delay line holding the maximum delay plus one block
      *
-     * Zero-pads beginning of impulse response buffer to match requested predelay.
-     * Expects given audio block to be large enough to accomodate predelay.
+     * Does nothing if the delay line is already large enough, so it is safe to call
+     * again with the same block size and sample rate while audio is being processed.
      *
-     * @param [in,out] ir   Impulse response to modify
+     * @param [in] maxBlockSize  Maximum expected number of samples per block
+     * @param [in] sr            Sample rate
      */
-    AudioBlock PreDelay::exec(AudioBlock ir)
+    void PreDelay::prepare(int maxBlockSize, double sr)
     {
-        const size_t numSamplesToAdd = getNumSamplesToAdd();
-        const size_t lengthWithoutPreDelay = (ir.getNumSamples() - numSamplesToAdd);
+        if (maxBlockSize <= 0 || sr <= 0.0)
+        {
+            return;
+        }
+
+        const int maxDelaySamples = (int)std::ceil(sr * (MAX_DELAY_MS / 1000.0));
 
-        if (numSamplesToAdd > 0)
+        if (maxBlockSize <= maxNumSamples && maxDelaySamples + maxNumSamples <= delayLine.getNumSamples())
         {
-            // Shift audio samples in memory to leave room for predelay
-            // NB: Use memmove instead of memcpy since dst and src will probably overlap
-            float * irPtr = ir.getChannelPointer(0);
-            memmove(irPtr + numSamplesToAdd, irPtr, lengthWithoutPreDelay * sizeof(float));
+            return;
+        }
+
+        maxNumSamples = std::max(maxBlockSize, maxNumSamples);
 
-            // Clear predelay samples
-            memset(irPtr, 0, numSamplesToAdd * sizeof(float));
+        delayLine.setSize(MAX_NUM_CHANNELS, maxDelaySamples + maxNumSamples);
+        delayLine.clear();
+
+        fadeBuffer.setSize(1, maxNumSamples);
+
+        writePosition = 0;
+        appliedDelaySamples = -1;
+    }
+
+    //==============================================================================
+    /**
+     * @brief Delays audio by the current pre-delay
+     *
+     * Blocks larger than the size given to prepare() are processed in chunks. If the
+     * delay changed since the last block, the output is crossfaded from the old to
+     * the new delay over this block.
+     *
+     * @param [in,out] audio    Audio to delay (up to MAX_NUM_CHANNELS channels)
+     */
+    AudioBlock PreDelay::exec(AudioBlock audio)
+    {
+        if (delayLine.getNumSamples() == 0)
+        {
+            jassertfalse;
+            return audio;
         }
 
+        const int numSamples = (int)audio.getNumSamples();
+        const int delaySamples = getDelaySamples();
+        const int prevDelaySamples = (appliedDelaySamples < 0) ? delaySamples : appliedDelaySamples;
+
+        for (int done = 0; done < numSamples; done += maxNumSamples)
+        {
+            const int chunkSize = std::min(numSamples - done, maxNumSamples);
+
+            processChunk(audio.getSubBlock((size_t)done, (size_t)chunkSize),
+                         prevDelaySamples, delaySamples, done, numSamples);
+        }
+
+        appliedDelaySamples = delaySamples;
+
         // Reset mustExec flag
         mustExec = false;
 
-        return ir;
+        return audio;
     }
 
-    //==============================================================================
     /**
-     * @brief Resizes given IR before processing
+     * @brief Writes a chunk to the delay line and reads it back delayed
      *
-     * @param [in,out] ir   IR to prepare
+     * @param [in,out] audio        Chunk (at most maxNumSamples samples)
+     * @param [in]     prevDelay    Delay (in samples) faded out over the block
+     * @param [in]     delay        Delay (in samples) faded in over the block
+     * @param [in]     fadeOffset   Position of chunk in the block
+     * @param [in]     fadeLength   Number of samples in the block
      */
-    void PreDelay::prepareIR(juce::AudioSampleBuffer& ir)
+    void PreDelay::processChunk(AudioBlock audio, int prevDelay, int delay,
+                                int fadeOffset, int fadeLength)
     {
-        ir.setSize(ir.getNumChannels(),
-                   ir.getNumSamples() + getNumSamplesToAdd(),
-                   true, false, false);
+        const int numSamples = (int)audio.getNumSamples();
+        const int numChannels = std::min((int)audio.getNumChannels(), MAX_NUM_CHANNELS);
+        const int lineLength = delayLine.getNumSamples();
+
+        // Write whole chunk first: the line is long enough that delayed reads never
+        // hit samples overwritten by this chunk
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const float* in = audio.getChannelPointer((size_t)ch);
+            float* line = delayLine.getWritePointer(ch);
+
+            const int firstPart = std::min(numSamples, lineLength - writePosition);
+
+            std::copy(in, in + firstPart, line + writePosition);
+            std::copy(in + firstPart, in + numSamples, line);
+        }
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            float* out = audio.getChannelPointer((size_t)ch);
+
+            readDelayed(ch, delay, out, numSamples);
+
+            if (prevDelay != delay)
+            {
+                float* prevOut = fadeBuffer.getWritePointer(0);
+
+                readDelayed(ch, prevDelay, prevOut, numSamples);
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    const float fade = (float)(fadeOffset + i) / fadeLength;
+
+                    out[i] = prevOut[i] + fade * (out[i] - prevOut[i]);
+                }
+            }
+        }
+
+        writePosition = (writePosition + numSamples) % lineLength;
     }
 
     /**
-     * @brief Returns expected number of samples after processing
+     * @brief Copies samples written a given delay before the current chunk
      *
-     * @param [in] inputNumSamples  Number of samples in input buffer
+     * @param [in]  channel     Delay line channel
+     * @param [in]  delay       Delay (in samples)
+     * @param [out] out         Delayed samples
+     * @param [in]  numSamples  Number of samples to copy
      */
-    int PreDelay::getNumSamplesToAdd()
+    void PreDelay::readDelayed(int channel, int delay, float* out, int numSamples) const
     {
-        return (int)std::ceil(sampleRate * (delayMs / 1000.0));
+        const int lineLength = delayLine.getNumSamples();
+        const float* line = delayLine.getReadPointer(channel);
+
+        int readPosition = writePosition - delay;
+
+        if (readPosition < 0)
+        {
+            readPosition += lineLength;
+        }
+
+        const int firstPart = std::min(numSamples, lineLength - readPosition);
+
+        std::copy(line + readPosition, line + readPosition + firstPart, out);
+        std::copy(line, line + (numSamples - firstPart), out + firstPart);
+    }
+
+    //==============================================================================
+    /**
+     * @brief Returns the current delay in samples
+     */
+    int PreDelay::getDelaySamples() const
+    {
+        const int maxDelaySamples = delayLine.getNumSamples() - maxNumSamples;
+
+        return std::min((int)std::ceil(sampleRate * (delayMs / 1000.0)), std::max(maxDelaySamples, 0));
     }
 
 }
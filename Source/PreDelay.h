@@ -17,7 +17,12 @@ namespace reverb
 
     //==============================================================================
     /**
-    * Implements a method to apply a pre-delay factor to a given impulse response.
+    * Delay line applying a pre-delay to the wet (convolved) signal.
+    *
+    * The delay line is allocated up front by prepare() for the maximum delay, so changing
+    * the delay (or the sample rate) is instant and neither allocates nor requires
+    * rebuilding the IR. When the delay
+    * changes, the output is crossfaded from the old to the new delay over one block.
     */
     class PreDelay : public Task
     {
@@ -32,18 +37,36 @@ namespace reverb
         virtual void updateParams(const juce::AudioProcessorValueTreeState& params,
                                   const juce::String& blockId) override;
 
-        virtual AudioBlock exec(AudioBlock ir) override;
+        virtual AudioBlock exec(AudioBlock audio) override;
+
+        virtual void updateSampleRate(double sr) override;
 
         //==============================================================================
-        void prepareIR(juce::AudioSampleBuffer& ir);
-        int getNumSamplesToAdd();
+        void prepare(int maxBlockSize, double sr);
+        int getDelaySamples() const;
+
+        static constexpr int MAX_NUM_CHANNELS = 2;
 
     protected:
         //==============================================================================
         static constexpr int MAX_DELAY_MS = 1000;
 
+        //==============================================================================
+        void processChunk(AudioBlock audio, int prevDelay, int delay,
+                          int fadeOffset, int fadeLength);
+        void readDelayed(int channel, int delay, float* out, int numSamples) const;
+
         //==============================================================================
         float delayMs = 0;
+
+        // Delay used for the last block (-1 before the first block)
+        int appliedDelaySamples = -1;
+
+        //==============================================================================
+        juce::AudioSampleBuffer delayLine;
+        juce::AudioSampleBuffer fadeBuffer;
+        int writePosition = 0;
+        int maxNumSamples = 0;
     };
 
 }
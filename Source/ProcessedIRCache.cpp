@@ -0,0 +1,344 @@
+/*
+  ==============================================================================
+
+    ProcessedIRCache.cpp
+
+  ==============================================================================
+*/
+
+#include "ProcessedIRCache.h"
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace reverb
+{
+
+    //==============================================================================
+    // Entry layout: header (magic, format version, number of channels, number of
+    // samples, number of source channels) followed by each channel's samples
+    static const int ENTRY_MAGIC = 0x52495651; // "QVIR"
+    static const int ENTRY_HEADER_BYTES = 5 * sizeof(int);
+
+    static const char* const ENTRY_EXTENSION = ".qvir";
+
+    //==============================================================================
+    /**
+     * @brief Returns a hash identifying the processed IR for this key
+     */
+    std::string ProcessedIRCache::Key::getHash() const
+    {
+        const int formatVersion = FORMAT_VERSION;
+
+        juce::MemoryBlock description;
+
+        description.append(&formatVersion, sizeof(formatVersion));
+        description.append(irNameOrFilePath.data(), irNameOrFilePath.size());
+        description.append(&irVersion, sizeof(irVersion));
+        description.append(&irSize, sizeof(irSize));
+        description.append(irContentHash.data(), irContentHash.size());
+        description.append(&numChannels, sizeof(numChannels));
+        description.append(&sampleRate, sizeof(sampleRate));
+        description.append(&irLengthS, sizeof(irLengthS));
+        description.append(&lengthMode, sizeof(lengthMode));
+        description.append(eqCoefficients.data(), eqCoefficients.size() * sizeof(float));
+
+        return juce::SHA256(description).toHexString().toStdString();
+    }
+
+    //==============================================================================
+    /**
+     * @brief Constructs a cache in the default directory and starts its writer thread
+     */
+    ProcessedIRCache::ProcessedIRCache()
+        : ProcessedIRCache(getDefaultDirectory())
+    {
+    }
+
+    /**
+     * @brief Constructs a cache in a given directory and starts its writer thread
+     *
+     * @param [in] directory    Cache directory (created on first store)
+     */
+    ProcessedIRCache::ProcessedIRCache(const juce::File& directory)
+        : juce::Thread("Processed IR cache writer"),
+          directory(directory)
+    {
+        startThread();
+    }
+
+    /**
+     * @brief Stops the writer thread, dropping any stores not yet written
+     *
+     * Waits for the store being written, if any, to complete.
+     */
+    ProcessedIRCache::~ProcessedIRCache()
+    {
+        stopThread(-1);
+    }
+
+    /**
+     * @brief Returns the cache directory shared by plugin instances (in the user's
+     *        application data directory)
+     */
+    juce::File ProcessedIRCache::getDefaultDirectory()
+    {
+        return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+                   .getChildFile("quantumVERB")
+                   .getChildFile("ProcessedIRs");
+    }
+
+    //==============================================================================
+    /**
+     * @brief Reads a processed IR from the cache
+     *
+     * Invalid entries (e.g. truncated files) are deleted.
+     *
+     * @param [in]  key                 Key of processed IR
+     * @param [out] ir                  Processed IR
+     * @param [out] numSourceChannels   Number of channels in the IR the entry was made from
+     *
+     * @returns False if the IR is not in the cache (outputs are then left untouched)
+     */
+    bool ProcessedIRCache::load(const Key& key, juce::AudioSampleBuffer& ir, int& numSourceChannels)
+    {
+        const juce::File file = getFile(key);
+
+        if (!file.existsAsFile())
+        {
+            return false;
+        }
+
+        {
+            juce::FileInputStream stream(file);
+
+            if (stream.failedToOpen())
+            {
+                return false;
+            }
+
+            const int magic = stream.readInt();
+            const int version = stream.readInt();
+            const int numChannels = stream.readInt();
+            const int numSamples = stream.readInt();
+            const int entryNumSourceChannels = stream.readInt();
+
+            const juce::int64 numSampleBytes = (juce::int64)numSamples * (juce::int64)sizeof(float);
+
+            const bool isValid = magic == ENTRY_MAGIC && version == FORMAT_VERSION &&
+                                 numChannels > 0 && numSamples > 0 && entryNumSourceChannels > 0 &&
+                                 stream.getTotalLength() == ENTRY_HEADER_BYTES + numChannels * numSampleBytes;
+
+            if (isValid)
+            {
+                juce::AudioSampleBuffer entry(numChannels, numSamples);
+
+                bool isComplete = true;
+                for (int channel = 0; channel < numChannels && isComplete; ++channel)
+                {
+                    isComplete = (stream.read(entry.getWritePointer(channel), (int)numSampleBytes) == numSampleBytes);
+                }
+
+                if (isComplete)
+                {
+                    ir = std::move(entry);
+                    numSourceChannels = entryNumSourceChannels;
+
+                    // Mark entry as recently used
+                    file.setLastModificationTime(juce::Time::getCurrentTime());
+
+                    return true;
+                }
+            }
+        }
+
+        file.deleteFile();
+
+        return false;
+    }
+
+    /**
+     * @brief Writes a processed IR to the cache in the background
+     *
+     * The IR is copied, so it can be changed right away. The store is dropped if
+     * MAX_NUM_PENDING_STORES are already waiting to be written.
+     *
+     * @param [in] key                  Key of processed IR
+     * @param [in] ir                   Processed IR
+     * @param [in] numSourceChannels    Number of channels in the IR it was made from
+     */
+    void ProcessedIRCache::store(const Key& key, const juce::AudioSampleBuffer& ir, int numSourceChannels)
+    {
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+
+            if ((int)pendingStores.size() >= MAX_NUM_PENDING_STORES)
+            {
+                return;
+            }
+
+            pendingStores.emplace_back(new PendingStore { getFile(key), ir, numSourceChannels });
+            ++numBusyStores;
+        }
+
+        notify();
+    }
+
+    /**
+     * @brief Blocks until all stores made so far are written
+     */
+    void ProcessedIRCache::waitForPendingStores()
+    {
+        while (numBusyStores > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    /**
+     * @brief Returns the file holding the processed IR for a given key
+     *
+     * @param [in] key  Key of processed IR
+     */
+    juce::File ProcessedIRCache::getFile(const Key& key) const
+    {
+        return directory.getChildFile(key.getHash() + ENTRY_EXTENSION);
+    }
+
+    //==============================================================================
+    /**
+     * @brief Writer thread body: write pending stores, then prune the cache
+     */
+    void ProcessedIRCache::run()
+    {
+        while (!threadShouldExit())
+        {
+            std::unique_ptr<PendingStore> pendingStore;
+
+            {
+                std::lock_guard<std::mutex> lock(pendingMutex);
+
+                if (!pendingStores.empty())
+                {
+                    pendingStore = std::move(pendingStores.front());
+                    pendingStores.pop_front();
+                }
+            }
+
+            if (!pendingStore)
+            {
+                wait(-1);
+                continue;
+            }
+
+            // Keep writer alive if a store fails: the cache is only an optimisation
+            try
+            {
+                write(*pendingStore);
+                prune();
+            }
+            catch (const std::exception& e)
+            {
+                std::string errMsg = "Could not store processed IR due to exception: ";
+                errMsg += e.what();
+
+                logger.dualPrint(Logger::Level::Error, errMsg);
+            }
+
+            --numBusyStores;
+        }
+    }
+
+    /**
+     * @brief Writes a cache entry
+     *
+     * Goes through a temporary file, so readers never see a partially written entry.
+     *
+     * @param [in] store    Entry to write
+     *
+     * @throws std::runtime_error
+     */
+    void ProcessedIRCache::write(const PendingStore& store)
+    {
+        store.file.getParentDirectory().createDirectory();
+
+        juce::TemporaryFile tempFile(store.file);
+
+        {
+            std::unique_ptr<juce::FileOutputStream> stream(tempFile.getFile().createOutputStream());
+
+            if (!stream || stream->failedToOpen())
+            {
+                throw std::runtime_error("Failed to open " + tempFile.getFile().getFullPathName().toStdString());
+            }
+
+            const int numChannels = store.ir.getNumChannels();
+            const int numSamples = store.ir.getNumSamples();
+
+            stream->writeInt(ENTRY_MAGIC);
+            stream->writeInt(FORMAT_VERSION);
+            stream->writeInt(numChannels);
+            stream->writeInt(numSamples);
+            stream->writeInt(store.numSourceChannels);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                stream->write(store.ir.getReadPointer(channel), (size_t)numSamples * sizeof(float));
+            }
+
+            stream->flush();
+
+            if (stream->getStatus().failed())
+            {
+                throw std::runtime_error("Failed to write " + tempFile.getFile().getFullPathName().toStdString());
+            }
+        }
+
+        if (!tempFile.overwriteTargetFileWithTemporary())
+        {
+            throw std::runtime_error("Failed to write " + store.file.getFullPathName().toStdString());
+        }
+    }
+
+    /**
+     * @brief Deletes least recently used entries until the cache fits in MAX_CACHE_BYTES
+     */
+    void ProcessedIRCache::prune()
+    {
+        juce::Array<juce::File> entries;
+        directory.findChildFiles(entries, juce::File::findFiles, false, juce::String("*") + ENTRY_EXTENSION);
+
+        juce::int64 totalBytes = 0;
+        for (const auto& entry : entries)
+        {
+            totalBytes += entry.getSize();
+        }
+
+        if (totalBytes <= (juce::int64)MAX_CACHE_BYTES)
+        {
+            return;
+        }
+
+        std::vector<juce::File> sortedEntries(entries.begin(), entries.end());
+        std::sort(sortedEntries.begin(), sortedEntries.end(),
+                  [](const juce::File& a, const juce::File& b) {
+            return a.getLastModificationTime() < b.getLastModificationTime();
+        });
+
+        for (const auto& entry : sortedEntries)
+        {
+            if (totalBytes <= (juce::int64)MAX_CACHE_BYTES)
+            {
+                break;
+            }
+
+            totalBytes -= entry.getSize();
+            entry.deleteFile();
+        }
+    }
+
+}
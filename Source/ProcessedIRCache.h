@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    ProcessedIRCache.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * Persistent on-disk cache of fully processed IRs.
+     *
+     * Entries are named after a hash of everything the processed IR depends on (source
+     * IR, number of channels, host sample rate, IR parameters and EQ), so reopening a session
+     * or going back to earlier settings doesn't process the IR again.
+     *
+     * Lookups read from disk on the calling thread. Stores are copied and written by a
+     * background thread, which also drops the least recently used entries once the
+     * cache directory grows past MAX_CACHE_BYTES.
+     *
+     * Plugin instances share the cache in the user's application data directory through
+     * a juce::SharedResourcePointer (default constructor), so its thread is stopped when
+     * the last instance goes away rather than when the plugin is unloaded.
+     */
+    class ProcessedIRCache : private juce::Thread
+    {
+    public:
+        //==============================================================================
+        struct Key
+        {
+            // IR name or file path, and its version: modification time and size (in bytes)
+            // for files, content hash for banked IRs (other fields left at 0)
+            std::string irNameOrFilePath;
+            juce::int64 irVersion = 0;
+            juce::int64 irSize = 0;
+            std::string irContentHash;
+
+            int numChannels = 0;
+            double sampleRate = 0.0;
+
+            float irLengthS = 0.0f;
+            int lengthMode = 0;
+
+            std::vector<float> eqCoefficients;
+
+            std::string getHash() const;
+        };
+
+        //==============================================================================
+        ProcessedIRCache();
+        explicit ProcessedIRCache(const juce::File& directory);
+        ~ProcessedIRCache();
+
+        ProcessedIRCache(const ProcessedIRCache&) = delete;
+        ProcessedIRCache& operator=(const ProcessedIRCache&) = delete;
+
+        //==============================================================================
+        static juce::File getDefaultDirectory();
+
+        //==============================================================================
+        bool load(const Key& key, juce::AudioSampleBuffer& ir, int& numSourceChannels);
+        void store(const Key& key, const juce::AudioSampleBuffer& ir, int numSourceChannels);
+
+        void waitForPendingStores();
+
+        juce::File getFile(const Key& key) const;
+
+        //==============================================================================
+        // Bump when IR processing changes, so entries from older versions are ignored
+        static constexpr int FORMAT_VERSION = 4;
+
+        static constexpr size_t MAX_CACHE_BYTES = 256 * 1024 * 1024;
+
+        // Stores beyond this are dropped (each holds a copy of an IR until written)
+        static constexpr int MAX_NUM_PENDING_STORES = 2;
+
+    protected:
+        //==============================================================================
+        struct PendingStore
+        {
+            juce::File file;
+            juce::AudioSampleBuffer ir;
+            int numSourceChannels;
+        };
+
+        void run() override;
+
+        static void write(const PendingStore& store);
+        void prune();
+
+        //==============================================================================
+        const juce::File directory;
+
+        std::mutex pendingMutex;
+        std::deque<std::unique_ptr<PendingStore>> pendingStores;
+        std::atomic<int> numBusyStores { 0 };
+    };
+
+}
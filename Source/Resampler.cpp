@@ -0,0 +1,216 @@
+/*
+  ==============================================================================
+
+    Resampler.cpp
+
+  ==============================================================================
+*/
+
+#include "Resampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * @brief Zeroth-order modified Bessel function of the first kind (power series)
+     */
+    static double besselI0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+
+        for (int k = 1; k < 50; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+
+            if (term < sum * 1e-12)
+            {
+                break;
+            }
+        }
+
+        return sum;
+    }
+
+    //==============================================================================
+    /**
+     * @brief Constructs a Resampler for a given conversion and tabulates its filter
+     *
+     * Allocates memory.
+     *
+     * @param [in] sourceSampleRate Sample rate of input signals
+     * @param [in] targetSampleRate Sample rate of output signals
+     */
+    Resampler::Resampler(double sourceSampleRate, double targetSampleRate)
+    {
+        jassert(sourceSampleRate > 0.0 && targetSampleRate > 0.0);
+
+        ratio = sourceSampleRate / targetSampleRate;
+
+        // Normalised cut-off (relative to the source Nyquist frequency)
+        const double cutoff = CUTOFF * std::min(1.0, 1.0 / ratio);
+
+        halfLength = (int)std::ceil(NUM_ZERO_CROSSINGS / cutoff);
+
+        const int numTaps = 2 * halfLength;
+        const double windowScale = 1.0 / besselI0(KAISER_BETA);
+
+        taps.resize((size_t)(NUM_PHASES + 1) * numTaps);
+
+        for (int phase = 0; phase <= NUM_PHASES; ++phase)
+        {
+            const double fraction = (double)phase / NUM_PHASES;
+
+            for (int k = 0; k < numTaps; ++k)
+            {
+                // Distance from the output sample to the source sample under this tap
+                const double distance = (k - halfLength + 1) - fraction;
+                const double x = juce::MathConstants<double>::pi * cutoff * distance;
+                const double sinc = (std::abs(x) < 1e-9) ? 1.0 : std::sin(x) / x;
+
+                const double position = distance / halfLength;
+                const double window = (std::abs(position) >= 1.0)
+                                    ? 0.0
+                                    : besselI0(KAISER_BETA * std::sqrt(1.0 - position * position)) * windowScale;
+
+                taps[(size_t)phase * numTaps + k] = (float)(cutoff * sinc * window);
+            }
+        }
+
+        tapDeltas.resize((size_t)NUM_PHASES * numTaps);
+
+        for (size_t i = 0; i < tapDeltas.size(); ++i)
+        {
+            tapDeltas[i] = taps[i + numTaps] - taps[i];
+        }
+    }
+
+    //==============================================================================
+    /**
+     * @brief Returns the number of samples a signal has after conversion
+     *
+     * @param [in] numSamples   Number of samples before conversion
+     */
+    int Resampler::getOutputNumSamples(int numSamples) const
+    {
+        return (int)std::lround(numSamples / ratio);
+    }
+
+    /**
+     * @brief Returns the input samples needed to compute a section of the output
+     *
+     * @param [in] destRange    Output samples to compute
+     * @param [in] numSamples   Number of samples in the whole input signal
+     *
+     * @returns Input samples under the filter for these output samples (within the signal)
+     */
+    juce::Range<int> Resampler::getInputRange(juce::Range<int> destRange, int numSamples) const
+    {
+        if (destRange.isEmpty())
+        {
+            return juce::Range<int>();
+        }
+
+        const int first = (int)(destRange.getStart() * ratio) - halfLength + 1;
+        const int end = (int)((destRange.getEnd() - 1) * ratio) + halfLength + 1;
+
+        return juce::Range<int>(juce::jlimit(0, numSamples, first), juce::jlimit(0, numSamples, end));
+    }
+
+    /**
+     * @brief Converts a signal
+     *
+     * @param [in]  source          Input signal
+     * @param [in]  numSamples      Number of input samples
+     * @param [out] dest            Output signal
+     * @param [in]  numDestSamples  Number of output samples (usually getOutputNumSamples())
+     */
+    void Resampler::process(const float* source, int numSamples, float* dest, int numDestSamples) const
+    {
+        process(source, juce::Range<int>(0, numSamples), numSamples,
+                dest, juce::Range<int>(0, numDestSamples));
+    }
+
+    /**
+     * @brief Converts a section of a signal
+     *
+     * Only reads the input samples in sourceRange, which must cover
+     * getInputRange(destRange).
+     *
+     * @param [in]  source      Input samples in sourceRange (source[0] is sample
+     *                          sourceRange.getStart() of the signal)
+     * @param [in]  sourceRange Input samples available
+     * @param [in]  numSamples  Number of samples in the whole input signal
+     * @param [out] dest        Output samples in destRange (dest[0] is sample
+     *                          destRange.getStart() of the output)
+     * @param [in]  destRange   Output samples to compute
+     */
+    void Resampler::process(const float* source, juce::Range<int> sourceRange, int numSamples,
+                            float* dest, juce::Range<int> destRange) const
+    {
+        jassert(sourceRange.contains(getInputRange(destRange, numSamples)) || destRange.isEmpty());
+
+        const int numTaps = 2 * halfLength;
+
+        // Samples outside the signal are silence
+        const int validStart = std::max(sourceRange.getStart(), 0);
+        const int validEnd = std::min(sourceRange.getEnd(), numSamples);
+
+        for (int n = destRange.getStart(); n < destRange.getEnd(); ++n)
+        {
+            // Position of output sample in source, split into sample index and phase
+            const double position = n * ratio;
+            const int index = (int)position;
+
+            const double phasePosition = (position - index) * NUM_PHASES;
+            const int phase = std::min((int)phasePosition, NUM_PHASES - 1);
+            const float phaseFraction = (float)(phasePosition - phase);
+
+            const float* phaseTaps = &taps[(size_t)phase * numTaps];
+            const float* phaseTapDeltas = &tapDeltas[(size_t)phase * numTaps];
+
+            // Skip taps falling outside the input (i.e. on silence)
+            const int first = index - halfLength + 1;
+            const int kStart = std::max(0, validStart - first);
+            const int kEnd = std::min(numTaps, validEnd - first);
+
+            const int offset = first - sourceRange.getStart();
+
+            float sum = 0.0f;
+
+            for (int k = kStart; k < kEnd; ++k)
+            {
+                sum += source[offset + k] * (phaseTaps[k] + phaseFraction * phaseTapDeltas[k]);
+            }
+
+            dest[n - destRange.getStart()] = sum;
+        }
+    }
+
+    /**
+     * @brief Converts all channels of a buffer
+     *
+     * Allocates memory.
+     *
+     * @param [in]  source  Input buffer
+     * @param [out] dest    Output buffer (resized to getOutputNumSamples())
+     */
+    void Resampler::process(const juce::AudioSampleBuffer& source, juce::AudioSampleBuffer& dest) const
+    {
+        const int numDestSamples = getOutputNumSamples(source.getNumSamples());
+
+        dest.setSize(source.getNumChannels(), numDestSamples);
+
+        for (int channel = 0; channel < source.getNumChannels(); ++channel)
+        {
+            process(source.getReadPointer(channel), source.getNumSamples(),
+                    dest.getWritePointer(channel), numDestSamples);
+        }
+    }
+
+}
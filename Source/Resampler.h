@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    Resampler.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#include <vector>
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * Converts signals between sample rates with a polyphase windowed-sinc filter.
+     *
+     * The filter is tabulated once per conversion ratio at NUM_PHASES fractional
+     * positions between two input samples. Each output sample interpolates between the
+     * two nearest phases, so any ratio (not just simple fractions) is supported. When
+     * downsampling, the cut-off follows the target Nyquist frequency to prevent
+     * aliasing.
+     *
+     * Meant for offline use (e.g. converting IRs), not for realtime streams: edges are
+     * padded with silence. Long signals may be converted in sections, each only needing
+     * the input samples given by getInputRange(), so they never have to be held in full.
+     */
+    class Resampler
+    {
+    public:
+        //==============================================================================
+        Resampler(double sourceSampleRate, double targetSampleRate);
+
+        //==============================================================================
+        int getOutputNumSamples(int numSamples) const;
+        juce::Range<int> getInputRange(juce::Range<int> destRange, int numSamples) const;
+
+        void process(const float* source, int numSamples, float* dest, int numDestSamples) const;
+        void process(const float* source, juce::Range<int> sourceRange, int numSamples,
+                     float* dest, juce::Range<int> destRange) const;
+        void process(const juce::AudioSampleBuffer& source, juce::AudioSampleBuffer& dest) const;
+
+        //==============================================================================
+        static constexpr int NUM_PHASES = 256;
+        static constexpr int NUM_ZERO_CROSSINGS = 32;
+
+        // Kaiser window shape (~90 dB stopband attenuation)
+        static constexpr double KAISER_BETA = 9.0;
+
+        // Cut-off relative to the lower of both Nyquist frequencies
+        static constexpr double CUTOFF = 0.95;
+
+    private:
+        //==============================================================================
+        // Source samples per output sample
+        double ratio;
+
+        // Filter taps on each side of an output sample (in source samples)
+        int halfLength;
+
+        // Taps for each phase (NUM_PHASES + 1 rows of 2 * halfLength taps), and the
+        // difference between each phase's taps and the next
+        std::vector<float> taps;
+        std::vector<float> tapDeltas;
+    };
+
+}
@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    SPSCQueue.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * Bounded lock-free single-producer single-consumer queue.
+     *
+     * push() and pop() never allocate, lock or block, so either side may be a realtime
+     * thread. Only one thread may push and only one thread may pop at any given time.
+     */
+    template <typename T>
+    class SPSCQueue
+    {
+    public:
+        //==============================================================================
+        /**
+         * @brief Constructs a queue holding up to capacity elements
+         *
+         * @param [in] capacity Maximum number of queued elements
+         */
+        SPSCQueue(size_t capacity)
+            : buffer(capacity + 1)
+        {
+            jassert(capacity > 0);
+        }
+
+        SPSCQueue(const SPSCQueue&) = delete;
+        SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+        //==============================================================================
+        /**
+         * @brief Appends an element to the queue (producer only)
+         *
+         * @param [in] element  Element to append
+         *
+         * @returns False if the queue is full
+         */
+        bool push(const T& element)
+        {
+            const size_t currentTail = tail.load(std::memory_order_relaxed);
+            const size_t nextTail = increment(currentTail);
+
+            if (nextTail == head.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            buffer[currentTail] = element;
+            tail.store(nextTail, std::memory_order_release);
+
+            return true;
+        }
+
+        /**
+         * @brief Removes the oldest element from the queue (consumer only)
+         *
+         * @param [out] element Removed element
+         *
+         * @returns False if the queue is empty
+         */
+        bool pop(T& element)
+        {
+            const size_t currentHead = head.load(std::memory_order_relaxed);
+
+            if (currentHead == tail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            element = buffer[currentHead];
+            head.store(increment(currentHead), std::memory_order_release);
+
+            return true;
+        }
+
+        /**
+         * @brief Returns true if there is nothing to pop (consumer only)
+         */
+        bool isEmpty() const
+        {
+            return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+        }
+
+        //==============================================================================
+        size_t getCapacity() const { return buffer.size() - 1; }
+
+    private:
+        //==============================================================================
+        size_t increment(size_t idx) const
+        {
+            return (idx + 1 == buffer.size()) ? 0 : idx + 1;
+        }
+
+        //==============================================================================
+        std::vector<T> buffer;
+
+        // Keep indices on separate cache lines so producer and consumer don't contend
+        alignas(64) std::atomic<size_t> head { 0 };
+        alignas(64) std::atomic<size_t> tail { 0 };
+    };
+
+}
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    Semaphore.cpp
+
+  ==============================================================================
+*/
+
+#include "Semaphore.h"
+
+#ifdef WIN32
+#include <windows.h>
+#elif JUCE_MAC || JUCE_IOS
+#include <dispatch/dispatch.h>
+#else
+#include <cerrno>
+#endif
+
+#include <climits>
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * @brief Constructs a semaphore with a count of zero
+     */
+    Semaphore::Semaphore()
+    {
+#ifdef WIN32
+        handle = CreateSemaphore(nullptr, 0, LONG_MAX, nullptr);
+#elif JUCE_MAC || JUCE_IOS
+        handle = (void*)dispatch_semaphore_create(0);
+#else
+        sem_init(&semaphore, 0, 0);
+#endif
+    }
+
+    Semaphore::~Semaphore()
+    {
+#ifdef WIN32
+        CloseHandle((HANDLE)handle);
+#elif JUCE_MAC || JUCE_IOS
+        dispatch_release((dispatch_semaphore_t)handle);
+#else
+        sem_destroy(&semaphore);
+#endif
+    }
+
+    //==============================================================================
+    /**
+     * @brief Increments the count, waking up a waiting thread if there is one
+     * (lock-free)
+     */
+    void Semaphore::signal()
+    {
+#ifdef WIN32
+        ReleaseSemaphore((HANDLE)handle, 1, nullptr);
+#elif JUCE_MAC || JUCE_IOS
+        dispatch_semaphore_signal((dispatch_semaphore_t)handle);
+#else
+        sem_post(&semaphore);
+#endif
+    }
+
+    /**
+     * @brief Waits until the count is positive, then decrements it
+     */
+    void Semaphore::wait()
+    {
+#ifdef WIN32
+        WaitForSingleObject((HANDLE)handle, INFINITE);
+#elif JUCE_MAC || JUCE_IOS
+        dispatch_semaphore_wait((dispatch_semaphore_t)handle, DISPATCH_TIME_FOREVER);
+#else
+        while (sem_wait(&semaphore) != 0 && errno == EINTR)
+        {
+        }
+#endif
+    }
+
+}
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    Semaphore.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#if !defined(WIN32) && !JUCE_MAC && !JUCE_IOS
+#include <semaphore.h>
+#endif
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * Counting semaphore built on the system's own, for waking up a thread from the
+     * audio thread.
+     *
+     * Unlike juce::WaitableEvent, signal() takes no lock, so it never waits for another
+     * thread: it is an atomic increment plus, at most, a kernel call waking up the waiting
+     * thread (Win32 semaphore, dispatch semaphore or futex).
+     */
+    class Semaphore
+    {
+    public:
+        //==============================================================================
+        Semaphore();
+        ~Semaphore();
+
+        Semaphore(const Semaphore&) = delete;
+        Semaphore& operator=(const Semaphore&) = delete;
+
+        //==============================================================================
+        void signal();
+        void wait();
+
+    private:
+        //==============================================================================
+#if defined(WIN32) || JUCE_MAC || JUCE_IOS
+        void* handle = nullptr;
+#else
+        sem_t semaphore;
+#endif
+    };
+
+}
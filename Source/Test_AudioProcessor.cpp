@@ -28,7 +28,7 @@ class AudioProcessorMocked : public reverb::AudioProcessor
 public:
     using AudioProcessor::AudioProcessor;
 
-    reverb::IRPipeline::Ptr getIRPipeline(int channelIdx) { return irPipelines[channelIdx]; }
+    reverb::IRPipeline::Ptr getIRPipeline() { return irPipeline; }
     reverb::MainPipeline::Ptr getMainPipeline(int channelIdx) { return mainPipelines[channelIdx]; }
 };
 
@@ -38,16 +38,26 @@ TEST_CASE("Test whole-processor behaviours", "[AudioProcessor]") {
     constexpr std::chrono::milliseconds BLOCK_DURATION_MS(20); // ms
     const int NUM_SAMPLES_PER_BLOCK = (int)std::ceil((BLOCK_DURATION_MS.count() / 1000.0) * SAMPLE_RATE);
 
+    // Keep processed IRs out of the user's application data directory (and start without
+    // any, so IRs are really processed)
+    const auto cacheDirectory = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                                    .getChildFile("quantumVERB_Test_AudioProcessor_cache");
+    cacheDirectory.deleteRecursively();
+
+    reverb::ProcessedIRCache processedIRCache(cacheDirectory);
+
     // Create AudioProcessor
     AudioProcessorMocked processor;
+    processor.setProcessedIRCache(&processedIRCache);
     processor.setPlayConfigDetails(NUM_CHANNELS, NUM_CHANNELS,
                                    SAMPLE_RATE, NUM_SAMPLES_PER_BLOCK);
 
     processor.prepareToPlay(SAMPLE_RATE, NUM_SAMPLES_PER_BLOCK);
-    
+
+    REQUIRE(processor.getIRPipeline() != nullptr);
+
     for (int i = 0; i < NUM_CHANNELS; ++i)
     {
-        REQUIRE(processor.getIRPipeline(i) != nullptr);
         REQUIRE(processor.getMainPipeline(i) != nullptr);
     }
 
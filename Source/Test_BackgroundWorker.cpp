@@ -0,0 +1,243 @@
+/*
+  ==============================================================================
+
+    Test_BackgroundWorker.cpp
+
+  ==============================================================================
+*/
+
+#include "catch.hpp"
+
+#include "BackgroundWorker.h"
+#include "SPSCQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#if defined(__GLIBC__)
+#include <dlfcn.h>
+#include <pthread.h>
+#endif
+
+/**
+ * How to write tests with Catch:
+ * https://github.com/catchorg/Catch2/blob/2bbba4f5444b7a90fcba92562426c14b11e87b76/docs/tutorial.md#writing-tests
+ */
+
+#if defined(__GLIBC__)
+namespace
+{
+    // Mutex locks taken by the current thread while counting is on
+    thread_local bool countMutexLocks = false;
+    thread_local int numMutexLocks = 0;
+}
+
+// Interposes the C library's pthread_mutex_lock(), which every std::mutex,
+// juce::CriticalSection and juce::WaitableEvent goes through
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept
+{
+    using LockFunction = int (*)(pthread_mutex_t*);
+    static const auto lockMutex = (LockFunction)dlsym(RTLD_NEXT, "pthread_mutex_lock");
+
+    if (countMutexLocks)
+    {
+        ++numMutexLocks;
+    }
+
+    return lockMutex(mutex);
+}
+#endif
+
+TEST_CASE("SPSCQueue is a bounded FIFO", "[BackgroundWorker]") {
+    constexpr int CAPACITY = 4;
+
+    reverb::SPSCQueue<int> queue(CAPACITY);
+    REQUIRE(queue.getCapacity() == CAPACITY);
+
+    int value = -1;
+    CHECK(!queue.pop(value));
+
+    // Wrap around the ring buffer a few times
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int i = 0; i < CAPACITY; ++i)
+        {
+            CHECK(queue.push(round * 10 + i));
+        }
+
+        CHECK(!queue.push(-1));
+
+        for (int i = 0; i < CAPACITY; ++i)
+        {
+            REQUIRE(queue.pop(value));
+            CHECK(value == round * 10 + i);
+        }
+
+        CHECK(!queue.pop(value));
+    }
+}
+
+TEST_CASE("SPSCQueue passes elements between threads in order", "[BackgroundWorker]") {
+    constexpr int NUM_ELEMENTS = 100000;
+
+    reverb::SPSCQueue<int> queue(16);
+
+    std::thread producer([&queue]() {
+        for (int i = 0; i < NUM_ELEMENTS; ++i)
+        {
+            while (!queue.push(i))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected = 0;
+    bool inOrder = true;
+
+    while (expected < NUM_ELEMENTS)
+    {
+        int value;
+
+        if (queue.pop(value))
+        {
+            inOrder = inOrder && (value == expected);
+            ++expected;
+        }
+    }
+
+    producer.join();
+
+    CHECK(inOrder);
+}
+
+TEST_CASE("BackgroundWorker runs the latest command per target", "[BackgroundWorker]") {
+    constexpr int NUM_TARGETS = 2;
+    constexpr int NUM_POSTS = 50;
+
+    std::atomic<int> numRuns[NUM_TARGETS];
+    std::atomic<double> lastValue[NUM_TARGETS];
+
+    for (int i = 0; i < NUM_TARGETS; ++i)
+    {
+        numRuns[i] = 0;
+        lastValue[i] = -1.0;
+    }
+
+    reverb::BackgroundWorker worker([&](const reverb::BackgroundWorker::Command& command) {
+        // Slow handler, so that commands pile up in the meantime
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        lastValue[command.target] = command.value;
+        numRuns[command.target]++;
+    }, NUM_TARGETS);
+
+    for (int i = 1; i <= NUM_POSTS; ++i)
+    {
+        reverb::BackgroundWorker::Command command;
+        command.target = i % NUM_TARGETS;
+        command.value = i;
+
+        REQUIRE(worker.post(command));
+    }
+
+    // Wait for the last commands to go through
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+    while ((lastValue[0] != NUM_POSTS || lastValue[1] != NUM_POSTS - 1) &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    CHECK(lastValue[0] == NUM_POSTS);
+    CHECK(lastValue[1] == NUM_POSTS - 1);
+
+    // Requests posted while the worker was busy were collapsed
+    CHECK(numRuns[0] + numRuns[1] < NUM_POSTS);
+}
+
+TEST_CASE("BackgroundWorker wakes up for commands posted while it sleeps", "[BackgroundWorker]") {
+    constexpr int NUM_POSTS = 20;
+
+    std::atomic<int> numRuns { 0 };
+
+    reverb::BackgroundWorker worker([&](const reverb::BackgroundWorker::Command&) {
+        numRuns++;
+    }, 1);
+
+    for (int i = 1; i <= NUM_POSTS; ++i)
+    {
+        // Leave the worker idle long enough to go to sleep (every other post)
+        if (i % 2 == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        reverb::BackgroundWorker::Command command;
+        command.value = i;
+
+        REQUIRE(worker.post(command));
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+        while (numRuns < i && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::yield();
+        }
+
+        REQUIRE(numRuns == i);
+    }
+}
+
+#if defined(__GLIBC__)
+TEST_CASE("BackgroundWorker::post() never takes a lock", "[BackgroundWorker]") {
+    constexpr int NUM_POSTS = 10;
+
+    // Make sure locks are actually counted
+    {
+        std::mutex mutex;
+
+        countMutexLocks = true;
+        std::lock_guard<std::mutex> lock(mutex);
+        countMutexLocks = false;
+
+        REQUIRE(numMutexLocks == 1);
+        numMutexLocks = 0;
+    }
+
+    std::atomic<int> numRuns { 0 };
+
+    reverb::BackgroundWorker worker([&](const reverb::BackgroundWorker::Command&) {
+        numRuns++;
+    }, 1);
+
+    for (int i = 1; i <= NUM_POSTS; ++i)
+    {
+        // Let the worker go to sleep, so that posting has to wake it up
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        reverb::BackgroundWorker::Command command;
+        command.value = i;
+
+        countMutexLocks = true;
+        const bool posted = worker.post(command);
+        countMutexLocks = false;
+
+        REQUIRE(posted);
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+        while (numRuns < i && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::yield();
+        }
+
+        REQUIRE(numRuns == i);
+    }
+
+    CHECK(numMutexLocks == 0);
+}
+#endif
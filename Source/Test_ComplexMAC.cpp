@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    Test_ComplexMAC.cpp
+
+  ==============================================================================
+*/
+
+#include "catch.hpp"
+
+#include "ComplexMAC.h"
+
+#include <vector>
+
+/**
+ * How to write tests with Catch:
+ * https://github.com/catchorg/Catch2/blob/2bbba4f5444b7a90fcba92562426c14b11e87b76/docs/tutorial.md#writing-tests
+ */
+
+TEST_CASE("SIMD complex multiply-accumulate matches scalar kernel", "[ComplexMAC]") {
+    using InstructionSet = reverb::ComplexMAC::InstructionSet;
+
+    // Odd sizes exercise the scalar remainder of the vector kernels
+    constexpr int NUM_BINS = 1031;
+    constexpr int NUM_ACCUMULATIONS = 4;
+
+    REQUIRE(reverb::ComplexMAC::isSupported(InstructionSet::scalar));
+    REQUIRE(reverb::ComplexMAC::isSupported(reverb::ComplexMAC::getBestInstructionSet()));
+
+    InstructionSet instructionSet = InstructionSet::scalar;
+
+    SECTION("SSE2 kernel") {
+        instructionSet = InstructionSet::sse2;
+    }
+
+    SECTION("AVX2+FMA kernel") {
+        instructionSet = InstructionSet::avx2;
+    }
+
+    if (!reverb::ComplexMAC::isSupported(instructionSet))
+    {
+        WARN("Instruction set not supported on this CPU, skipping");
+        return;
+    }
+
+    auto scalarKernel = reverb::ComplexMAC::getKernel(InstructionSet::scalar);
+    auto simdKernel = reverb::ComplexMAC::getKernel(instructionSet);
+
+    juce::Random random(1234);
+
+    for (int numBins : { 1, 3, 4, 7, 8, 9, 16, 17, NUM_BINS })
+    {
+        std::vector<float> expectedRe(numBins, 0.0f), expectedIm(numBins, 0.0f);
+        std::vector<float> resultRe(numBins, 0.0f), resultIm(numBins, 0.0f);
+
+        // Accumulate several products, like a convolution stage does over partitions
+        for (int n = 0; n < NUM_ACCUMULATIONS; ++n)
+        {
+            std::vector<float> aRe(numBins), aIm(numBins), bRe(numBins), bIm(numBins);
+
+            for (int k = 0; k < numBins; ++k)
+            {
+                aRe[k] = random.nextFloat() * 2.0f - 1.0f;
+                aIm[k] = random.nextFloat() * 2.0f - 1.0f;
+                bRe[k] = random.nextFloat() * 2.0f - 1.0f;
+                bIm[k] = random.nextFloat() * 2.0f - 1.0f;
+            }
+
+            scalarKernel(expectedRe.data(), expectedIm.data(),
+                         aRe.data(), aIm.data(), bRe.data(), bIm.data(), numBins);
+
+            simdKernel(resultRe.data(), resultIm.data(),
+                       aRe.data(), aIm.data(), bRe.data(), bIm.data(), numBins);
+        }
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            CHECK(resultRe[k] == Approx(expectedRe[k]).margin(1e-5));
+            CHECK(resultIm[k] == Approx(expectedIm[k]).margin(1e-5));
+        }
+    }
+}
+
+TEST_CASE("Complex multiply-accumulate computes complex products", "[ComplexMAC]") {
+    // (1 + 2i)(3 + 4i) = -5 + 10i, (-1 + 0.5i)(2 - 2i) = -1 + 3i
+    const float aRe[] = { 1.0f, -1.0f };
+    const float aIm[] = { 2.0f, 0.5f };
+    const float bRe[] = { 3.0f, 2.0f };
+    const float bIm[] = { 4.0f, -2.0f };
+
+    float accRe[] = { 1.0f, 0.0f };
+    float accIm[] = { 0.0f, 1.0f };
+
+    reverb::ComplexMAC::process(accRe, accIm, aRe, aIm, bRe, bIm, 2);
+
+    CHECK(accRe[0] == Approx(-4.0f));
+    CHECK(accIm[0] == Approx(10.0f));
+    CHECK(accRe[1] == Approx(-1.0f));
+    CHECK(accIm[1] == Approx(4.0f));
+}
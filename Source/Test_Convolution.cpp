@@ -12,7 +12,10 @@ Test_Convolution.cpp
 #include "Convolution.h"
 #include "PluginProcessor.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <thread>
 
 /**
 * How to write tests with Catch:
@@ -145,3 +148,336 @@ TEST_CASE("Use a Convolution object to convolve two buffers", "[Convolution]") {
         }
     }
 }
+
+TEST_CASE("Partitioned convolution matches direct convolution", "[Convolution]") {
+    constexpr int SAMPLE_RATE = 48000;
+    constexpr int NUM_CHANNELS = 1;
+    constexpr int NUM_SAMPLES_PER_BLOCK = 128;
+    constexpr int IR_NUM_SAMPLES = 20000;
+    constexpr int AUDIO_NUM_SAMPLES = 24000;
+
+    reverb::AudioProcessor processor;
+    processor.setPlayConfigDetails(NUM_CHANNELS, NUM_CHANNELS,
+                                   SAMPLE_RATE, NUM_SAMPLES_PER_BLOCK);
+
+    bool zeroLatency = false;
+
+    SECTION("Partitioned head (one partition of latency)") {
+        zeroLatency = false;
+    }
+
+    SECTION("Direct-form FIR head (zero latency)") {
+        zeroLatency = true;
+    }
+
+    reverb::Convolution convolution(&processor);
+    convolution.prepare(NUM_SAMPLES_PER_BLOCK, zeroLatency);
+
+    const int LATENCY = convolution.getLatencySamples();
+
+    if (zeroLatency)
+    {
+        REQUIRE(LATENCY == 0);
+    }
+    else
+    {
+        REQUIRE(LATENCY == reverb::ConvolutionEngine::getHeadSizeForBlockSize(NUM_SAMPLES_PER_BLOCK));
+    }
+
+    // Random IR and input signal
+    juce::Random random(42);
+
+    juce::AudioSampleBuffer ir(1, IR_NUM_SAMPLES);
+    for (int i = 0; i < IR_NUM_SAMPLES; ++i)
+    {
+        ir.setSample(0, i, random.nextFloat() * 2.0f - 1.0f);
+    }
+
+    juce::AudioSampleBuffer input(1, AUDIO_NUM_SAMPLES + LATENCY);
+    input.clear();
+    for (int i = 0; i < AUDIO_NUM_SAMPLES; ++i)
+    {
+        input.setSample(0, i, random.nextFloat() * 2.0f - 1.0f);
+    }
+
+    convolution.loadIR(ir);
+
+    // Process in irregular block sizes to exercise internal buffering
+    juce::AudioSampleBuffer output;
+    output.makeCopyOf(input);
+
+    int pos = 0;
+    int blockIdx = 0;
+
+    while (pos < output.getNumSamples())
+    {
+        const int blockSize = std::min(NUM_SAMPLES_PER_BLOCK - (blockIdx++ % 3) * 17,
+                                       output.getNumSamples() - pos);
+
+        reverb::AudioBlock block = reverb::AudioBlock(output).getSubBlock((size_t)pos, (size_t)blockSize);
+        convolution.exec(block);
+
+        pos += blockSize;
+    }
+
+    // Compare against direct convolution (sparse check for speed)
+    for (int i = 0; i < AUDIO_NUM_SAMPLES; i += 7)
+    {
+        double expected = 0.0;
+
+        for (int j = 0; j <= std::min(i, IR_NUM_SAMPLES - 1); ++j)
+        {
+            expected += (double)ir.getSample(0, j) * input.getSample(0, i - j);
+        }
+
+        CHECK(output.getSample(0, i + LATENCY) == Approx(expected).margin(1e-3));
+    }
+}
+
+TEST_CASE("True-stereo convolution mixes both inputs into each output", "[Convolution]") {
+    constexpr int SAMPLE_RATE = 48000;
+    constexpr int NUM_CHANNELS = 2;
+    constexpr int NUM_SAMPLES_PER_BLOCK = 128;
+    constexpr int IR_NUM_SAMPLES = 12000;
+    constexpr int AUDIO_NUM_SAMPLES = 15000;
+
+    reverb::AudioProcessor processor;
+    processor.setPlayConfigDetails(NUM_CHANNELS, NUM_CHANNELS,
+                                   SAMPLE_RATE, NUM_SAMPLES_PER_BLOCK);
+
+    reverb::Convolution convolution(&processor);
+    convolution.prepare(NUM_SAMPLES_PER_BLOCK, true, true);
+
+    REQUIRE(convolution.getNumIRChannels() == 4);
+    REQUIRE(convolution.getLatencySamples() == 0);
+
+    // Random 4-channel IR (L->L, L->R, R->L, R->R) and stereo input signal
+    juce::Random random(7);
+
+    juce::AudioSampleBuffer ir(4, IR_NUM_SAMPLES);
+    for (int ch = 0; ch < ir.getNumChannels(); ++ch)
+    {
+        for (int i = 0; i < IR_NUM_SAMPLES; ++i)
+        {
+            ir.setSample(ch, i, random.nextFloat() * 2.0f - 1.0f);
+        }
+    }
+
+    juce::AudioSampleBuffer input(NUM_CHANNELS, AUDIO_NUM_SAMPLES);
+    for (int ch = 0; ch < NUM_CHANNELS; ++ch)
+    {
+        for (int i = 0; i < AUDIO_NUM_SAMPLES; ++i)
+        {
+            input.setSample(ch, i, random.nextFloat() * 2.0f - 1.0f);
+        }
+    }
+
+    convolution.loadIR(ir);
+
+    juce::AudioSampleBuffer output;
+    output.makeCopyOf(input);
+
+    for (int pos = 0; pos < AUDIO_NUM_SAMPLES; pos += NUM_SAMPLES_PER_BLOCK)
+    {
+        const int blockSize = std::min(NUM_SAMPLES_PER_BLOCK, AUDIO_NUM_SAMPLES - pos);
+
+        reverb::AudioBlock block = reverb::AudioBlock(output).getSubBlock((size_t)pos, (size_t)blockSize);
+        convolution.exec(block);
+    }
+
+    // Compare against direct convolution of each input/output path
+    for (int out = 0; out < NUM_CHANNELS; ++out)
+    {
+        for (int i = 0; i < AUDIO_NUM_SAMPLES; i += 11)
+        {
+            double expected = 0.0;
+
+            for (int in = 0; in < NUM_CHANNELS; ++in)
+            {
+                const int path = in * NUM_CHANNELS + out;
+
+                for (int j = 0; j <= std::min(i, IR_NUM_SAMPLES - 1); ++j)
+                {
+                    expected += (double)ir.getSample(path, j) * input.getSample(in, i - j);
+                }
+            }
+
+            CHECK(output.getSample(out, i) == Approx(expected).margin(1e-3));
+        }
+    }
+}
+
+TEST_CASE("IR can be replaced while audio is being processed", "[Convolution]") {
+    constexpr int SAMPLE_RATE = 48000;
+    constexpr int NUM_CHANNELS = 1;
+    constexpr int NUM_SAMPLES_PER_BLOCK = 128;
+    constexpr int IR_NUM_SAMPLES = 5000;
+    constexpr int NUM_IR_LOADS = 200;
+
+    reverb::AudioProcessor processor;
+    processor.setPlayConfigDetails(NUM_CHANNELS, NUM_CHANNELS,
+                                   SAMPLE_RATE, NUM_SAMPLES_PER_BLOCK);
+
+    reverb::Convolution convolution(&processor);
+    convolution.prepare(NUM_SAMPLES_PER_BLOCK, true);
+
+    // Two scaled unit impulses: output is always the input times 1 or 2
+    juce::AudioSampleBuffer ir1(1, IR_NUM_SAMPLES);
+    juce::AudioSampleBuffer ir2(1, IR_NUM_SAMPLES);
+    ir1.clear();
+    ir2.clear();
+    ir1.setSample(0, 0, 1.0f);
+    ir2.setSample(0, 0, 2.0f);
+
+    convolution.loadIR(ir1);
+
+    std::atomic<bool> stop(false);
+    std::atomic<bool> outputValid(true);
+
+    // Audio thread keeps convolving a constant signal
+    std::thread audioThread([&]() {
+        juce::AudioSampleBuffer audio(1, NUM_SAMPLES_PER_BLOCK);
+
+        while (!stop)
+        {
+            for (int i = 0; i < NUM_SAMPLES_PER_BLOCK; ++i)
+            {
+                audio.setSample(0, i, 1.0f);
+            }
+
+            reverb::AudioBlock block(audio);
+            convolution.exec(block);
+
+            const float sample = audio.getSample(0, NUM_SAMPLES_PER_BLOCK - 1);
+
+            if (sample != Approx(1.0f).margin(1e-3) && sample != Approx(2.0f).margin(1e-3))
+            {
+                outputValid = false;
+            }
+        }
+    });
+
+    for (int i = 0; i < NUM_IR_LOADS; ++i)
+    {
+        convolution.loadIR((i % 2) ? ir1 : ir2);
+    }
+
+    stop = true;
+    audioThread.join();
+
+    CHECK(outputValid);
+}
+
+TEST_CASE("IR changes are crossfaded", "[Convolution]") {
+    constexpr int SAMPLE_RATE = 48000;
+    constexpr int NUM_CHANNELS = 1;
+    constexpr int NUM_SAMPLES_PER_BLOCK = 128;
+    constexpr int IR_NUM_SAMPLES = 5000;
+    constexpr int CROSSFADE_LENGTH = 1000;
+    constexpr int NUM_BLOCKS = 20;
+
+    reverb::AudioProcessor processor;
+    processor.setPlayConfigDetails(NUM_CHANNELS, NUM_CHANNELS,
+                                   SAMPLE_RATE, NUM_SAMPLES_PER_BLOCK);
+
+    reverb::Convolution convolution(&processor);
+    convolution.prepare(NUM_SAMPLES_PER_BLOCK, true);
+    convolution.setCrossfadeLength(CROSSFADE_LENGTH);
+
+    juce::AudioSampleBuffer ir1(1, IR_NUM_SAMPLES);
+    juce::AudioSampleBuffer ir2(1, IR_NUM_SAMPLES);
+    ir1.clear();
+    ir2.clear();
+    ir1.setSample(0, 0, 1.0f);
+    ir2.setSample(0, 0, 2.0f);
+
+    juce::AudioSampleBuffer audio(1, NUM_SAMPLES_PER_BLOCK);
+
+    auto processConstantBlock = [&]() {
+        for (int i = 0; i < NUM_SAMPLES_PER_BLOCK; ++i)
+        {
+            audio.setSample(0, i, 1.0f);
+        }
+
+        reverb::AudioBlock block(audio);
+        convolution.exec(block);
+    };
+
+    // First IR is used straight away
+    convolution.loadIR(ir1);
+    processConstantBlock();
+
+    CHECK(audio.getSample(0, 0) == Approx(1.0f).margin(1e-4));
+    CHECK(convolution.getNumCrossfadeSamples() == 0);
+
+    // Output ramps linearly from the old to the new IR's
+    convolution.loadIR(ir2);
+
+    for (int block = 0; block < NUM_BLOCKS; ++block)
+    {
+        processConstantBlock();
+
+        for (int i = 0; i < NUM_SAMPLES_PER_BLOCK; ++i)
+        {
+            const int position = block * NUM_SAMPLES_PER_BLOCK + i;
+            const float expected = (position < CROSSFADE_LENGTH)
+                                 ? 1.0f + (float)position / CROSSFADE_LENGTH
+                                 : 2.0f;
+
+            REQUIRE(audio.getSample(0, i) == Approx(expected).margin(1e-3));
+        }
+    }
+
+    CHECK(convolution.getNumCrossfadeSamples() == CROSSFADE_LENGTH);
+}
+
+TEST_CASE("Built IRs only take effect once published", "[Convolution]") {
+    constexpr int SAMPLE_RATE = 48000;
+    constexpr int NUM_CHANNELS = 1;
+    constexpr int NUM_SAMPLES_PER_BLOCK = 256;
+    constexpr int IR_NUM_SAMPLES = 2048;
+
+    reverb::AudioProcessor processor;
+    processor.setPlayConfigDetails(NUM_CHANNELS, NUM_CHANNELS,
+                                   SAMPLE_RATE, NUM_SAMPLES_PER_BLOCK);
+
+    reverb::Convolution convolution(&processor);
+    convolution.prepare(NUM_SAMPLES_PER_BLOCK, true);
+
+    juce::AudioSampleBuffer ir1(1, IR_NUM_SAMPLES);
+    juce::AudioSampleBuffer ir2(1, IR_NUM_SAMPLES);
+    ir1.clear();
+    ir2.clear();
+    ir1.setSample(0, 0, 1.0f);
+    ir2.setSample(0, 0, 2.0f);
+
+    juce::AudioSampleBuffer audio(1, NUM_SAMPLES_PER_BLOCK);
+
+    auto processConstantBlock = [&]() {
+        for (int i = 0; i < NUM_SAMPLES_PER_BLOCK; ++i)
+        {
+            audio.setSample(0, i, 1.0f);
+        }
+
+        reverb::AudioBlock block(audio);
+        convolution.exec(block);
+    };
+
+    convolution.loadIR(ir1);
+    CHECK_FALSE(convolution.publishIR());
+
+    // A built IR is not used until it is published
+    convolution.buildIR(ir2);
+    processConstantBlock();
+
+    CHECK(audio.getSample(0, NUM_SAMPLES_PER_BLOCK - 1) == Approx(1.0f).margin(1e-4));
+
+    REQUIRE(convolution.publishIR());
+    CHECK_FALSE(convolution.publishIR());
+
+    processConstantBlock();
+
+    CHECK(audio.getSample(0, NUM_SAMPLES_PER_BLOCK - 1) == Approx(2.0f).margin(1e-4));
+
+    convolution.collectRetiredEngines();
+}
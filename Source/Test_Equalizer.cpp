@@ -50,6 +50,13 @@ namespace reverb {
         float getQ(float q, int id) {
             return filterSet[id]->Q;
         }
+
+        // Reference cascade: one full pass per filter
+        void execFilters(AudioBlock ir) {
+            for (int i = 0; i < filterSet.size(); i++) {
+                filterSet[i]->exec(ir);
+            }
+        }
     };
 }
 
@@ -217,4 +224,113 @@ TEST_CASE("Equalizer class is tested", "[equalizer]")
     }
 
     delete[] fftBuffer;
-}
\ No newline at end of file
+}
+
+
+TEST_CASE("Equalizer runs its filter cascade in a single pass", "[equalizer]")
+{
+    constexpr int sampleRate = 44100;
+    constexpr int channelNumber = 1;
+    constexpr int numSamples = 20000;
+
+    reverb::AudioProcessor processor;
+    processor.setPlayConfigDetails(channelNumber, channelNumber, sampleRate, 512);
+
+    int numFilters = 4;
+
+    SECTION("Minimum number of filters") {
+        numFilters = reverb::Equalizer::MIN_NUM_FILTERS;
+    }
+
+    SECTION("Default number of filters") {
+        numFilters = 4;
+    }
+
+    SECTION("Maximum number of filters") {
+        numFilters = reverb::Equalizer::MAX_NUM_FILTERS;
+    }
+
+    reverb::EqualizerMocked EQ(&processor, numFilters);
+    reverb::EqualizerMocked referenceEQ(&processor, numFilters);
+
+    REQUIRE(EQ.getNumFilters() == numFilters);
+
+    // Impulse followed by noise
+    juce::Random random(42);
+
+    juce::AudioBuffer<float> input(channelNumber, numSamples);
+    for (int i = 0; i < numSamples; i++) {
+        input.setSample(0, i, random.nextFloat() * 2.0f - 1.0f);
+    }
+    input.setSample(0, 0, 1.0f);
+
+    juce::AudioBuffer<float> output;
+    output.makeCopyOf(input);
+    EQ.exec(output);
+
+    juce::AudioBuffer<float> expected;
+    expected.makeCopyOf(input);
+    referenceEQ.execFilters(expected);
+
+    for (int i = 0; i < numSamples; i++) {
+        REQUIRE(output.getSample(0, i) == Approx(expected.getSample(0, i)).margin(1e-4));
+    }
+
+    CHECK_FALSE(EQ.needsToRun());
+
+    // Each call starts from silence
+    juce::AudioBuffer<float> secondOutput;
+    secondOutput.makeCopyOf(input);
+    EQ.exec(secondOutput);
+
+    for (int i = 0; i < numSamples; i++) {
+        REQUIRE(secondOutput.getSample(0, i) == output.getSample(0, i));
+    }
+
+    // Channels filtered in parallel on a worker pool give the same output
+    constexpr int numPoolChannels = 4;
+
+    reverb::WorkerPool pool(numPoolChannels - 1, false);
+    EQ.setWorkerPool(&pool);
+
+    juce::AudioBuffer<float> poolOutput(numPoolChannels, numSamples);
+    for (int ch = 0; ch < numPoolChannels; ch++) {
+        poolOutput.copyFrom(ch, 0, input, 0, 0, numSamples);
+    }
+    EQ.exec(poolOutput);
+
+    EQ.setWorkerPool(nullptr);
+
+    for (int ch = 0; ch < numPoolChannels; ch++) {
+        for (int i = 0; i < numSamples; i++) {
+            REQUIRE(poolOutput.getSample(ch, i) == output.getSample(0, i));
+        }
+    }
+}
+
+TEST_CASE("Equalizer response can be evaluated at many frequencies at once", "[equalizer]")
+{
+    constexpr int sampleRate = 44100;
+    constexpr int channelNumber = 1;
+    constexpr int numFrequencies = 200;
+
+    reverb::AudioProcessor processor;
+    processor.setPlayConfigDetails(channelNumber, channelNumber, sampleRate, 512);
+
+    reverb::Equalizer EQ(&processor);
+
+    std::vector<float> frequencies(numFrequencies);
+    for (int i = 0; i < numFrequencies; i++) {
+        frequencies[i] = 20.0f * std::pow(1000.0f, i / (numFrequencies - 1.0f));
+    }
+
+    reverb::MagnitudeResponse response;
+    response.prepare(frequencies.data(), numFrequencies, sampleRate);
+
+    std::vector<float> dBAmplitudes(numFrequencies);
+    EQ.getdBAmplitudes(response, dBAmplitudes.data());
+
+    for (int i = 0; i < numFrequencies; i++) {
+        REQUIRE(dBAmplitudes[i] == Approx(EQ.getdBAmplitude(frequencies[i])).margin(0.01));
+    }
+}
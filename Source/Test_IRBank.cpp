@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    Test_IRBank.cpp
+
+  ==============================================================================
+*/
+
+#include "catch.hpp"
+
+#include "IRBank.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+/**
+ * How to write tests with Catch:
+ * https://github.com/catchorg/Catch2/blob/2bbba4f5444b7a90fcba92562426c14b11e87b76/docs/tutorial.md#writing-tests
+ */
+
+TEST_CASE("Banked IRs are used in place", "[IRBank]") {
+    auto& irBank = reverb::IRBank::getInstance();
+
+    REQUIRE_FALSE(irBank.irs.empty());
+
+    SECTION("Views match IR info") {
+        for (const auto& ir : irBank.irs)
+        {
+            const auto block = irBank.getBlock(ir.first);
+
+            CHECK(ir.second.sampleRate > 0.0);
+            CHECK(block.getNumChannels() == (size_t)ir.second.numChannels);
+            CHECK(block.getNumSamples() == (size_t)ir.second.numSamples);
+
+            float magnitude = 0.0f;
+            for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+            {
+                const float* samples = block.getChannelPointer(channel);
+
+                // Channels are aligned for vectorised copies
+                CHECK(reinterpret_cast<std::uintptr_t>(samples) % 16 == 0);
+
+                for (size_t i = 0; i < block.getNumSamples(); ++i)
+                {
+                    magnitude = std::max(magnitude, std::abs(samples[i]));
+                }
+            }
+
+            CHECK(magnitude > 0.0f);
+            CHECK(magnitude <= 1.0f);
+        }
+    }
+
+    SECTION("Samples are not copied") {
+        const std::string irName = irBank.irs.begin()->first;
+
+        CHECK(irBank.getBlock(irName).getChannelPointer(0) ==
+              irBank.getBlock(irName).getChannelPointer(0));
+    }
+
+    SECTION("Unknown IRs are rejected") {
+        CHECK_THROWS_AS(irBank.getBlock("not_an_ir"), std::invalid_argument);
+    }
+}
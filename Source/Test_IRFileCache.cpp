@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    Test_IRFileCache.cpp
+
+  ==============================================================================
+*/
+
+#include "catch.hpp"
+
+#include "IRFileCache.h"
+
+#include <cmath>
+#include <stdexcept>
+
+/**
+ * How to write tests with Catch:
+ * https://github.com/catchorg/Catch2/blob/2bbba4f5444b7a90fcba92562426c14b11e87b76/docs/tutorial.md#writing-tests
+ */
+
+//==============================================================================
+/**
+ * @brief Writes a WAV file with a different sine amplitude on each channel
+ */
+static void writeIRFile(const juce::File& file, int numChannels, int numSamples, double sampleRate)
+{
+    file.deleteFile();
+
+    juce::AudioSampleBuffer buffer(numChannels, numSamples);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            buffer.setSample(channel, i, (channel + 1) * 0.1f * std::sin(0.01f * i));
+        }
+    }
+
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer(
+        wavFormat.createWriterFor(file.createOutputStream(), sampleRate, (unsigned)numChannels,
+                                  24, juce::StringPairArray(), 0));
+
+    REQUIRE(writer);
+    writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+}
+
+TEST_CASE("IR files are decoded once and shared", "[IRFileCache]") {
+    constexpr double SAMPLE_RATE = 48000.0;
+    constexpr int NUM_SAMPLES = 4800;
+
+    auto& cache = reverb::IRFileCache::getInstance();
+
+    const auto tempDir = juce::File::getSpecialLocation(juce::File::tempDirectory);
+    const auto fileA = tempDir.getChildFile("quantumVERB_Test_IRFileCache_a.wav");
+    const auto fileB = tempDir.getChildFile("quantumVERB_Test_IRFileCache_b.wav");
+
+    writeIRFile(fileA, 2, NUM_SAMPLES, SAMPLE_RATE);
+    writeIRFile(fileB, 1, NUM_SAMPLES, SAMPLE_RATE);
+
+    const std::string pathA = fileA.getFullPathName().toStdString();
+    const std::string pathB = fileB.getFullPathName().toStdString();
+
+    SECTION("All channels are decoded in one read") {
+        auto ir = cache.open(pathA).getDecodedIR();
+
+        REQUIRE(ir->buffer.getNumChannels() == 2);
+        CHECK(ir->buffer.getNumSamples() == NUM_SAMPLES);
+        CHECK(ir->sampleRate == SAMPLE_RATE);
+
+        CHECK(ir->buffer.getMagnitude(0, 0, NUM_SAMPLES) == Approx(0.1f).margin(1e-3));
+        CHECK(ir->buffer.getMagnitude(1, 0, NUM_SAMPLES) == Approx(0.2f).margin(1e-3));
+    }
+
+    SECTION("Unchanged files are not read again") {
+        auto ir = cache.open(pathA).getDecodedIR();
+
+        CHECK(cache.open(pathA).getDecodedIR() == ir);
+    }
+
+    SECTION("Changed files are read again") {
+        auto ir = cache.open(pathA).getDecodedIR();
+
+        writeIRFile(fileA, 2, 2 * NUM_SAMPLES, SAMPLE_RATE);
+
+        auto changedIR = cache.open(pathA).getDecodedIR();
+
+        CHECK(changedIR != ir);
+        CHECK(changedIR->buffer.getNumSamples() == 2 * NUM_SAMPLES);
+
+        // The previous version remains valid while in use
+        CHECK(ir->buffer.getNumSamples() == NUM_SAMPLES);
+    }
+
+    SECTION("Least recently used files are dropped to meet the memory budget") {
+        cache.setMemoryBudget(0);
+
+        auto irA = cache.open(pathA).getDecodedIR();
+        auto irB = cache.open(pathB).getDecodedIR();
+
+        CHECK(cache.getMemoryUsage() == NUM_SAMPLES * sizeof(float));
+        CHECK(cache.open(pathB).getDecodedIR() == irB);
+        CHECK(cache.open(pathA).getDecodedIR() != irA);
+
+        cache.setMemoryBudget(reverb::IRFileCache::DEFAULT_MEMORY_BUDGET);
+    }
+
+    SECTION("Long files are streamed instead of cached") {
+        const int longNumSamples = (int)(reverb::IRFileCache::MAX_CACHED_FILE_BYTES / (2 * sizeof(float))) + 1000;
+
+        writeIRFile(fileB, 2, longNumSamples, SAMPLE_RATE);
+
+        const size_t memoryUsage = cache.getMemoryUsage();
+        const auto source = cache.open(pathB);
+
+        CHECK_FALSE(source.getDecodedIR());
+        CHECK(source.getNumChannels() == 2);
+        CHECK(source.getNumSamples() == longNumSamples);
+        CHECK(source.getSampleRate() == SAMPLE_RATE);
+        CHECK(cache.getMemoryUsage() == memoryUsage);
+
+        // Channels are taken in turn, across chunk boundaries
+        juce::AudioSampleBuffer ir(4, longNumSamples);
+        source.read(ir);
+
+        for (int i : { 0, 1234, reverb::IRFileCache::CHUNK_NUM_SAMPLES, longNumSamples - 1 })
+        {
+            for (int channel = 0; channel < ir.getNumChannels(); ++channel)
+            {
+                const float expected = ((channel % 2) + 1) * 0.1f * std::sin(0.01f * i);
+                CHECK(ir.getSample(channel, i) == Approx(expected).margin(1e-5));
+            }
+        }
+    }
+
+    SECTION("Missing files are rejected") {
+        CHECK_THROWS_AS(cache.open(tempDir.getChildFile("quantumVERB_missing.wav").getFullPathName().toStdString()),
+                        std::invalid_argument);
+    }
+
+    fileA.deleteFile();
+    fileB.deleteFile();
+}
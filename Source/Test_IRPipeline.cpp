@@ -9,11 +9,14 @@
 #include "catch.hpp"
 
 #include "IRBank.h"
+#include "IRFileCache.h"
 #include "IRPipeline.h"
 #include "PluginProcessor.h"
 #include "Logger.h"
 
+#include <algorithm>
 #include <chrono>
+#include <new>
 
 /**
 * How to write tests with Catch:
@@ -22,6 +25,18 @@
 
 // TODO: Test parameter changes
 
+//==============================================================================
+/**
+ * Equalizer failing as if the IR couldn't be allocated.
+ */
+class FailingEqualizer : public reverb::Equalizer
+{
+public:
+    using Equalizer::Equalizer;
+
+    reverb::AudioBlock exec(reverb::AudioBlock) override { throw std::bad_alloc(); }
+};
+
 //==============================================================================
 /**
  * Mocked IRPipeline class for loading custom IR buffers in unit tests.
@@ -33,6 +48,31 @@ public:
 
     //==============================================================================
     juce::String getIRName() { return irNameOrFilePath; }
+
+    using IRPipeline::getFirstStageToRun;
+
+    void setIRFilePath(const std::string& path) { irNameOrFilePath = path; }
+
+    // Next run reloads the IR, then fails in its last stage
+    void failNextRun()
+    {
+        equalizer = std::make_shared<FailingEqualizer>(processor);
+        mustExec = true;
+    }
+
+    const juce::AudioSampleBuffer& getStretchedIR() const { return *stageOutputs[STAGE_TIME_STRETCH]; }
+
+    // Converted IR is shared between the resample stage and the resampled IR cache
+    bool isResampledIRShared() const
+    {
+        return !resampledIRs.empty() && resampledIRs.front().buffer == stageOutputs[STAGE_RESAMPLE];
+    }
+
+    size_t getResampledIRsNumBytes() const { return resampledIRsNumBytes; }
+
+    // Loaded IR is only held once if already at the host rate
+    bool isLoadedIRShared() const { return stageOutputs[STAGE_LOAD] == stageOutputs[STAGE_RESAMPLE]; }
+    int getLoadedNumSamples() const { return stageOutputs[STAGE_LOAD]->getNumSamples(); }
 };
 
 TEST_CASE("Use an IRPipeline to manipulate an impulse response", "[IRPipeline]") {
@@ -48,12 +88,12 @@ TEST_CASE("Use an IRPipeline to manipulate an impulse response", "[IRPipeline]")
 
     REQUIRE(processor.getSampleRate() == IR_SAMPLE_RATE);
 
-    IRPipelineMocked irPipeline(&processor, 0);
+    IRPipelineMocked irPipeline(&processor);
     irPipeline.updateParams(processor.parameters);
     irPipeline.updateSampleRate(IR_SAMPLE_RATE);
     
     auto& irBank = reverb::IRBank::getInstance();
-    REQUIRE(irPipeline.getIRName() == irBank.buffers.begin()->first);
+    REQUIRE(irPipeline.getIRName() == irBank.irs.begin()->first);
 
 
     SECTION("IR processing shouldn't be excessively long") {
@@ -70,4 +110,351 @@ TEST_CASE("Use an IRPipeline to manipulate an impulse response", "[IRPipeline]")
 
         CHECK(execTime.count() < MAX_EXEC_TIME_MS.count());
     }
+
+    SECTION("Only stages after a parameter change are re-run") {
+        REQUIRE(irPipeline.getFirstStageToRun() == reverb::IRPipeline::STAGE_LOAD);
+
+        irPipeline.exec();
+
+        CHECK(irPipeline.getFirstStageToRun() == reverb::IRPipeline::NUM_STAGES);
+
+        // Predelay is applied to the wet signal, not the IR
+        auto preDelayParam = processor.parameters.getParameter(reverb::AudioProcessor::PID_PREDELAY);
+        auto preDelayRange = processor.parameters.getParameterRange(reverb::AudioProcessor::PID_PREDELAY);
+        preDelayParam->setValueNotifyingHost(preDelayRange.convertTo0to1(10.0f));
+        irPipeline.updateParams(processor.parameters);
+
+        CHECK(irPipeline.getFirstStageToRun() == reverb::IRPipeline::NUM_STAGES);
+
+        // So is IR gain
+        auto gainParam = processor.parameters.getParameter(reverb::AudioProcessor::PID_IR_GAIN);
+        gainParam->setValueNotifyingHost(gainParam->getValue() * 0.5f);
+        irPipeline.updateParams(processor.parameters);
+
+        CHECK(irPipeline.getFirstStageToRun() == reverb::IRPipeline::NUM_STAGES);
+
+        // Changing the EQ only re-filters the stretched IR
+        auto filterGainParam = processor.parameters.getParameter(
+            juce::String(reverb::AudioProcessor::PID_FILTER_PREFIX) + "0" +
+            reverb::AudioProcessor::PID_FILTER_GAIN_SUFFIX);
+        filterGainParam->setValueNotifyingHost(filterGainParam->getValue() * 0.5f);
+        irPipeline.updateParams(processor.parameters);
+
+        REQUIRE(irPipeline.getFirstStageToRun() == reverb::IRPipeline::STAGE_EQUALIZER);
+
+        irPipeline.exec();
+
+        CHECK(irPipeline.getFirstStageToRun() == reverb::IRPipeline::NUM_STAGES);
+
+        // Changing IR length skips loading
+        auto lengthParam = processor.parameters.getParameter(reverb::AudioProcessor::PID_IR_LENGTH);
+        lengthParam->setValueNotifyingHost(lengthParam->getValue() * 0.5f);
+        irPipeline.updateParams(processor.parameters);
+
+        REQUIRE(irPipeline.getFirstStageToRun() == reverb::IRPipeline::STAGE_TIME_STRETCH);
+
+        irPipeline.exec();
+
+        CHECK(irPipeline.getFirstStageToRun() == reverb::IRPipeline::NUM_STAGES);
+    }
+
+    SECTION("EQ filters the stretched IR in the time domain") {
+        irPipeline.exec();
+
+        // Boost the low shelf, cut a narrow peak and boost the other one
+        const float filterGains[] = { 0.9f, 0.1f, 0.8f, 0.5f };
+        const float filterQs[] = { 0.5f, 1.0f, 0.5f, 0.5f };
+
+        for (int i = 0; i < 4; ++i)
+        {
+            const juce::String filterId = juce::String(reverb::AudioProcessor::PID_FILTER_PREFIX) + juce::String(i);
+
+            processor.parameters.getParameter(filterId + reverb::AudioProcessor::PID_FILTER_GAIN_SUFFIX)
+                ->setValueNotifyingHost(filterGains[i]);
+            processor.parameters.getParameter(filterId + reverb::AudioProcessor::PID_FILTER_Q_SUFFIX)
+                ->setValueNotifyingHost(filterQs[i]);
+        }
+
+        irPipeline.updateParams(processor.parameters);
+
+        REQUIRE(irPipeline.getFirstStageToRun() == reverb::IRPipeline::STAGE_EQUALIZER);
+
+        auto ir = irPipeline.exec();
+
+        // Same as running the EQ's shelf and peak filters over the whole stretched IR
+        reverb::Equalizer referenceEQ(&processor);
+        referenceEQ.updateSampleRate(IR_SAMPLE_RATE);
+
+        for (int i = 0; i < referenceEQ.getNumFilters(); ++i)
+        {
+            referenceEQ.updateParams(processor.parameters, reverb::AudioProcessor::PID_FILTER_PREFIX + std::to_string(i));
+        }
+
+        juce::AudioSampleBuffer expected;
+        expected.makeCopyOf(irPipeline.getStretchedIR());
+        referenceEQ.exec(reverb::AudioBlock(expected));
+
+        REQUIRE(ir.getNumChannels() == (size_t)expected.getNumChannels());
+        REQUIRE(ir.getNumSamples() == (size_t)expected.getNumSamples());
+
+        float maxDifference = 0.0f;
+        bool isFiltered = false;
+
+        for (size_t channel = 0; channel < ir.getNumChannels(); ++channel)
+        {
+            for (size_t i = 0; i < ir.getNumSamples(); ++i)
+            {
+                const float sample = ir.getSample((int)channel, (int)i);
+
+                maxDifference = std::max(maxDifference, std::abs(sample - expected.getSample((int)channel, (int)i)));
+                isFiltered |= (sample != irPipeline.getStretchedIR().getSample((int)channel, (int)i));
+            }
+        }
+
+        CHECK(maxDifference < 1e-6f);
+        CHECK(isFiltered);
+    }
+
+    SECTION("A failed run leaves the previous IR untouched") {
+        auto ir = irPipeline.exec();
+
+        juce::AudioSampleBuffer expected;
+        expected.setSize((int)ir.getNumChannels(), (int)ir.getNumSamples());
+
+        for (size_t channel = 0; channel < ir.getNumChannels(); ++channel)
+        {
+            expected.copyFrom((int)channel, 0, ir.getChannelPointer(channel), (int)ir.getNumSamples());
+        }
+
+        irPipeline.failNextRun();
+        CHECK_THROWS_AS(irPipeline.exec(), std::bad_alloc);
+
+        // Blocks handed out by the previous run (e.g. to the main pipelines) still hold it
+        for (size_t channel = 0; channel < ir.getNumChannels(); ++channel)
+        {
+            CHECK(std::equal(ir.getChannelPointer(channel), ir.getChannelPointer(channel) + ir.getNumSamples(),
+                             expected.getReadPointer((int)channel)));
+        }
+    }
+
+    SECTION("Changing the sample rate converts the IR without reloading it") {
+        const int numSamples = irPipeline.exec().getNumSamples();
+
+        irPipeline.updateSampleRate(IR_SAMPLE_RATE / 2);
+
+        REQUIRE(irPipeline.getFirstStageToRun() == reverb::IRPipeline::STAGE_RESAMPLE);
+
+        const int numHalfRateSamples = irPipeline.exec().getNumSamples();
+
+        CHECK(std::abs(2 * numHalfRateSamples - numSamples) <= 2);
+
+        // Converted IRs are cached, so switching back is cheap (and gives the same IR)
+        irPipeline.updateSampleRate(IR_SAMPLE_RATE);
+        CHECK(irPipeline.exec().getNumSamples() == numSamples);
+
+        // Without being copied
+        CHECK(irPipeline.isResampledIRShared());
+        const size_t maxNumBytes = reverb::IRPipeline::MAX_RESAMPLED_IR_BYTES;
+        CHECK(irPipeline.getResampledIRsNumBytes() <= maxNumBytes);
+
+        irPipeline.updateSampleRate(IR_SAMPLE_RATE / 2);
+        CHECK(irPipeline.exec().getNumSamples() == numHalfRateSamples);
+    }
+
+    SECTION("Processed IRs are fetched from the processed IR cache") {
+        const auto directory = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                                   .getChildFile("quantumVERB_Test_IRPipeline_cache");
+        directory.deleteRecursively();
+
+        reverb::ProcessedIRCache cache(directory);
+
+        irPipeline.setProcessedIRCache(&cache);
+        auto ir = irPipeline.exec();
+
+        cache.waitForPendingStores();
+
+        // Same settings in another session: nothing to process
+        IRPipelineMocked otherPipeline(&processor);
+        otherPipeline.setProcessedIRCache(&cache);
+        otherPipeline.updateParams(processor.parameters);
+        otherPipeline.updateSampleRate(IR_SAMPLE_RATE);
+
+        auto cachedIR = otherPipeline.exec();
+
+        CHECK_FALSE(otherPipeline.needsToRun());
+        CHECK(otherPipeline.getNumSourceChannels() == irPipeline.getNumSourceChannels());
+        REQUIRE(cachedIR.getNumChannels() == ir.getNumChannels());
+        REQUIRE(cachedIR.getNumSamples() == ir.getNumSamples());
+
+        for (size_t channel = 0; channel < ir.getNumChannels(); ++channel)
+        {
+            CHECK(std::equal(ir.getChannelPointer(channel), ir.getChannelPointer(channel) + ir.getNumSamples(),
+                             cachedIR.getChannelPointer(channel)));
+        }
+
+        irPipeline.setProcessedIRCache(nullptr);
+        otherPipeline.setProcessedIRCache(nullptr);
+        directory.deleteRecursively();
+    }
+
+    SECTION("A processed IR cache hit keeps the outputs of earlier stages") {
+        const auto directory = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                                   .getChildFile("quantumVERB_Test_IRPipeline_cache");
+        directory.deleteRecursively();
+
+        reverb::ProcessedIRCache cache(directory);
+
+        irPipeline.setProcessedIRCache(&cache);
+        irPipeline.exec();
+
+        const juce::AudioSampleBuffer* stretchedIR = &irPipeline.getStretchedIR();
+
+        auto filterGainParam = processor.parameters.getParameter(
+            juce::String(reverb::AudioProcessor::PID_FILTER_PREFIX) + "0" +
+            reverb::AudioProcessor::PID_FILTER_GAIN_SUFFIX);
+        const float filterGain = filterGainParam->getValue();
+
+        filterGainParam->setValueNotifyingHost(filterGain * 0.5f);
+        irPipeline.updateParams(processor.parameters);
+        irPipeline.exec();
+
+        cache.waitForPendingStores();
+
+        // Going back to the first EQ settings fetches the IR from the cache...
+        filterGainParam->setValueNotifyingHost(filterGain);
+        irPipeline.updateParams(processor.parameters);
+
+        REQUIRE(irPipeline.getFirstStageToRun() == reverb::IRPipeline::STAGE_EQUALIZER);
+        irPipeline.exec();
+
+        // ...after which another EQ change still only re-filters the stretched IR
+        filterGainParam->setValueNotifyingHost(filterGain * 0.25f);
+        irPipeline.updateParams(processor.parameters);
+
+        CHECK(irPipeline.getFirstStageToRun() == reverb::IRPipeline::STAGE_EQUALIZER);
+        irPipeline.exec();
+
+        CHECK(&irPipeline.getStretchedIR() == stretchedIR);
+
+        irPipeline.setProcessedIRCache(nullptr);
+        directory.deleteRecursively();
+    }
+
+    SECTION("All channels are normalised with one common gain") {
+        constexpr int NUM_SAMPLES = 4800;
+
+        const auto file = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                              .getChildFile("quantumVERB_Test_IRPipeline_balance.wav");
+        file.deleteFile();
+
+        // Second channel twice as loud as the first
+        juce::AudioSampleBuffer buffer(IR_NUM_CHANNELS, NUM_SAMPLES);
+
+        for (int channel = 0; channel < IR_NUM_CHANNELS; ++channel)
+        {
+            for (int i = 0; i < NUM_SAMPLES; ++i)
+            {
+                buffer.setSample(channel, i, (channel + 1) * 0.1f * std::sin(0.01f * i));
+            }
+        }
+
+        {
+            juce::WavAudioFormat wavFormat;
+            std::unique_ptr<juce::AudioFormatWriter> writer(
+                wavFormat.createWriterFor(file.createOutputStream(), IR_SAMPLE_RATE,
+                                          (unsigned)IR_NUM_CHANNELS, 24, juce::StringPairArray(), 0));
+
+            REQUIRE(writer);
+            writer->writeFromAudioSampleBuffer(buffer, 0, NUM_SAMPLES);
+        }
+
+        irPipeline.setNumChannels(IR_NUM_CHANNELS);
+        irPipeline.setIRFilePath(file.getFullPathName().toStdString());
+        auto ir = irPipeline.reloadIR();
+
+        REQUIRE(ir.getNumChannels() == (size_t)IR_NUM_CHANNELS);
+
+        const auto range0 = ir.getSingleChannelBlock(0).findMinAndMax();
+        const auto range1 = ir.getSingleChannelBlock(1).findMinAndMax();
+        const float magnitude0 = std::max(std::abs(range0.getStart()), std::abs(range0.getEnd()));
+        const float magnitude1 = std::max(std::abs(range1.getStart()), std::abs(range1.getEnd()));
+
+        const float maxIntensity = reverb::IRPipeline::MAX_IR_INTENSITY;
+
+        CHECK(magnitude1 == Approx(maxIntensity).margin(1e-3));
+        CHECK(magnitude0 == Approx(maxIntensity / 2).margin(1e-3));
+
+        file.deleteFile();
+    }
+
+    SECTION("Long IR files are converted to the host rate while being read") {
+        constexpr int FILE_SAMPLE_RATE = IR_SAMPLE_RATE / 2;
+        const int numSamples = (int)(reverb::IRFileCache::MAX_CACHED_FILE_BYTES / (IR_NUM_CHANNELS * sizeof(float))) + 1000;
+
+        const auto file = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                              .getChildFile("quantumVERB_Test_IRPipeline_long.wav");
+        file.deleteFile();
+
+        {
+            juce::AudioSampleBuffer buffer(IR_NUM_CHANNELS, numSamples);
+
+            for (int channel = 0; channel < IR_NUM_CHANNELS; ++channel)
+            {
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    buffer.setSample(channel, i, 0.5f * std::sin(0.01f * i + channel));
+                }
+            }
+
+            juce::WavAudioFormat wavFormat;
+            std::unique_ptr<juce::AudioFormatWriter> writer(
+                wavFormat.createWriterFor(file.createOutputStream(), FILE_SAMPLE_RATE,
+                                          (unsigned)IR_NUM_CHANNELS, 24, juce::StringPairArray(), 0));
+
+            REQUIRE(writer);
+            writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+        }
+
+        irPipeline.setNumChannels(IR_NUM_CHANNELS);
+        irPipeline.setIRFilePath(file.getFullPathName().toStdString());
+        irPipeline.exec();
+
+        // Loaded at the host rate: no native rate copy, nothing left to convert
+        CHECK(std::abs(irPipeline.getLoadedNumSamples() - 2 * numSamples) <= 2);
+        CHECK(irPipeline.isLoadedIRShared());
+
+        // So a new host rate reloads the file
+        irPipeline.updateSampleRate(FILE_SAMPLE_RATE);
+        CHECK(irPipeline.getFirstStageToRun() == reverb::IRPipeline::STAGE_LOAD);
+
+        irPipeline.exec();
+
+        CHECK(irPipeline.getLoadedNumSamples() == numSamples);
+        CHECK(irPipeline.isLoadedIRShared());
+
+        file.deleteFile();
+    }
+
+    SECTION("All channels are processed in one pass") {
+        irPipeline.setNumChannels(IR_NUM_CHANNELS);
+
+        REQUIRE(irPipeline.needsToRun());
+
+        auto ir = irPipeline.exec();
+
+        const bool isTrueStereo = (irPipeline.getNumSourceChannels() ==
+                                   reverb::IRPipeline::NUM_TRUE_STEREO_IR_CHANNELS);
+
+        CHECK(ir.getNumChannels() == (size_t)(isTrueStereo ? reverb::IRPipeline::NUM_TRUE_STEREO_IR_CHANNELS
+                                                           : IR_NUM_CHANNELS));
+        CHECK(ir.getNumChannels() == (size_t)irPipeline.getNumIRChannels());
+        CHECK(ir.getNumSamples() > 0);
+        CHECK_FALSE(irPipeline.needsToRun());
+
+        // Changing the number of channels reprocesses the IR
+        irPipeline.setNumChannels(1);
+
+        REQUIRE(irPipeline.needsToRun());
+        CHECK(irPipeline.exec().getNumChannels() == 1);
+    }
 }
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    Test_MagnitudeResponse.cpp
+
+  ==============================================================================
+*/
+
+#include "catch.hpp"
+
+#include "Filter.h"
+#include "MagnitudeResponse.h"
+
+#include <vector>
+
+/**
+ * How to write tests with Catch:
+ * https://github.com/catchorg/Catch2/blob/2bbba4f5444b7a90fcba92562426c14b11e87b76/docs/tutorial.md#writing-tests
+ */
+
+TEST_CASE("Batched magnitude response matches direct evaluation", "[MagnitudeResponse]") {
+    constexpr double SAMPLE_RATE = 44100.0;
+
+    // Odd count exercises the scalar remainder of the vector loop
+    constexpr int NUM_FREQUENCIES = 1001;
+
+    using Coefficients = juce::dsp::IIR::Coefficients<float>;
+
+    // Low, narrow and strong bands are the hardest to evaluate accurately
+    std::vector<Coefficients::Ptr> filters = {
+        Coefficients::makeLowShelf(SAMPLE_RATE, 60.0f, 0.71f, 5.2f),
+        Coefficients::makePeakFilter(SAMPLE_RATE, 80.0f, 4.0f, 0.06f),
+        Coefficients::makePeakFilter(SAMPLE_RATE, 2600.0f, 0.71f, 5.2f),
+        Coefficients::makeHighShelf(SAMPLE_RATE, 8000.0f, 0.71f, 0.06f)
+    };
+
+    const int numBands = (int)filters.size();
+
+    std::vector<const float*> bands;
+    for (auto& filter : filters)
+    {
+        bands.push_back(filter->getRawCoefficients());
+    }
+
+    std::vector<float> frequencies(NUM_FREQUENCIES);
+    for (int f = 0; f < NUM_FREQUENCIES; ++f)
+    {
+        frequencies[f] = f * 22000.0f / (NUM_FREQUENCIES - 1);
+    }
+
+    reverb::MagnitudeResponse response;
+    response.prepare(frequencies.data(), NUM_FREQUENCIES, SAMPLE_RATE);
+
+    REQUIRE(response.getNumFrequencies() == NUM_FREQUENCIES);
+
+    // Reference: dB magnitude of each band from its complex response
+    std::vector<double> expected((size_t)NUM_FREQUENCIES * numBands);
+
+    for (int f = 0; f < NUM_FREQUENCIES; ++f)
+    {
+        for (int b = 0; b < numBands; ++b)
+        {
+            const auto h = reverb::Filter::getResponse(*filters[b], frequencies[f] / SAMPLE_RATE);
+            expected[f * numBands + b] = 20.0 * std::log10(std::abs(h));
+        }
+    }
+
+    SECTION("Each band") {
+        std::vector<float> dBMagnitudes((size_t)NUM_FREQUENCIES * numBands);
+        response.getdBMagnitudes(bands.data(), numBands, dBMagnitudes.data());
+
+        for (size_t i = 0; i < dBMagnitudes.size(); ++i)
+        {
+            REQUIRE(dBMagnitudes[i] == Approx(expected[i]).margin(0.01));
+        }
+    }
+
+    SECTION("Bands in cascade") {
+        std::vector<float> dBMagnitudes(NUM_FREQUENCIES);
+        response.getTotaldBMagnitudes(bands.data(), numBands, dBMagnitudes.data());
+
+        for (int f = 0; f < NUM_FREQUENCIES; ++f)
+        {
+            double total = 0.0;
+
+            for (int b = 0; b < numBands; ++b)
+            {
+                total += expected[f * numBands + b];
+            }
+
+            REQUIRE(dBMagnitudes[f] == Approx(total).margin(0.01));
+        }
+    }
+}
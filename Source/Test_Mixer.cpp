@@ -10,6 +10,7 @@
 #include "PluginProcessor.h"
 #include "Mixer.h"
 #include <chrono>
+#include <vector>
 
 
 /**
@@ -86,3 +87,135 @@ TEST_CASE("Mixer class is tested", "[Mixer]")
     }
 
 }
+
+TEST_CASE("Mixer fuses dry/wet mixing and output gain", "[Mixer]")
+{
+    constexpr int SAMPLE_RATE = 48000;
+    constexpr int NUM_CHANNELS = 2;
+    constexpr int NUM_SAMPLES = 517;
+
+    reverb::AudioProcessor processor;
+    processor.setPlayConfigDetails(NUM_CHANNELS, NUM_CHANNELS,
+                                   SAMPLE_RATE, NUM_SAMPLES);
+
+    MixerMocked mixer(&processor);
+    mixer.prepare(NUM_SAMPLES);
+
+    juce::Random random(42);
+
+    juce::AudioSampleBuffer dryAudio(NUM_CHANNELS, NUM_SAMPLES);
+    juce::AudioSampleBuffer wetAudio(NUM_CHANNELS, NUM_SAMPLES);
+
+    for (int ch = 0; ch < NUM_CHANNELS; ++ch)
+    {
+        for (int i = 0; i < NUM_SAMPLES; i++)
+        {
+            dryAudio.setSample(ch, i, random.nextFloat() * 2 - 1);
+            wetAudio.setSample(ch, i, random.nextFloat() * 2 - 1);
+        }
+    }
+
+    SECTION("Constant parameters") {
+        constexpr float WET_RATIO = 0.3f;
+        constexpr float GAIN = 0.8f;
+
+        juce::AudioSampleBuffer audio(wetAudio);
+
+        mixer.setWetRatio(WET_RATIO);
+        mixer.loadDry(dryAudio);
+        mixer.exec(audio, GAIN, GAIN);
+
+        for (int ch = 0; ch < NUM_CHANNELS; ++ch)
+        {
+            for (int i = 0; i < NUM_SAMPLES; i++)
+            {
+                const float expected = (wetAudio.getSample(ch, i) * WET_RATIO +
+                                        dryAudio.getSample(ch, i) * (1 - WET_RATIO)) * GAIN;
+
+                REQUIRE(audio.getSample(ch, i) == Approx(expected).margin(1e-5));
+            }
+        }
+    }
+
+    SECTION("Wet gain only scales the wet signal") {
+        constexpr float WET_RATIO = 0.6f;
+        constexpr float GAIN = 0.8f;
+        constexpr float WET_GAIN = 0.25f;
+
+        juce::AudioSampleBuffer audio(wetAudio);
+
+        mixer.setWetRatio(WET_RATIO);
+        mixer.loadDry(dryAudio);
+        mixer.exec(audio, GAIN, GAIN, WET_GAIN, WET_GAIN);
+
+        for (int ch = 0; ch < NUM_CHANNELS; ++ch)
+        {
+            for (int i = 0; i < NUM_SAMPLES; i++)
+            {
+                const float expected = (wetAudio.getSample(ch, i) * WET_GAIN * WET_RATIO +
+                                        dryAudio.getSample(ch, i) * (1 - WET_RATIO)) * GAIN;
+
+                REQUIRE(audio.getSample(ch, i) == Approx(expected).margin(1e-5));
+            }
+        }
+    }
+
+    SECTION("Parameters are ramped over a block") {
+        constexpr float WET_RATIO_START = 0.2f;
+        constexpr float WET_RATIO_END = 0.9f;
+        constexpr float GAIN_START = 1.0f;
+        constexpr float GAIN_END = 0.5f;
+
+        juce::AudioSampleBuffer audio(wetAudio);
+
+        mixer.setWetRatio(WET_RATIO_START);
+        mixer.loadDry(dryAudio);
+        mixer.exec(audio, GAIN_START, GAIN_START);
+
+        audio.makeCopyOf(wetAudio);
+
+        mixer.setWetRatio(WET_RATIO_END);
+        mixer.loadDry(dryAudio);
+        mixer.exec(audio, GAIN_START, GAIN_END);
+
+        const float wetGainStart = WET_RATIO_START * GAIN_START;
+        const float wetGainEnd = WET_RATIO_END * GAIN_END;
+        const float dryGainStart = (1 - WET_RATIO_START) * GAIN_START;
+        const float dryGainEnd = (1 - WET_RATIO_END) * GAIN_END;
+
+        for (int ch = 0; ch < NUM_CHANNELS; ++ch)
+        {
+            for (int i = 0; i < NUM_SAMPLES; i++)
+            {
+                const float t = (float)i / NUM_SAMPLES;
+                const float expected =
+                    wetAudio.getSample(ch, i) * (wetGainStart + t * (wetGainEnd - wetGainStart)) +
+                    dryAudio.getSample(ch, i) * (dryGainStart + t * (dryGainEnd - dryGainStart));
+
+                REQUIRE(audio.getSample(ch, i) == Approx(expected).margin(1e-5));
+            }
+        }
+    }
+
+    SECTION("Kernel handles all lengths") {
+        for (int numSamples : { 0, 1, 3, 4, 5, 8, 13 })
+        {
+            std::vector<float> out(numSamples + 1, -1.0f);
+
+            reverb::Mixer::mix(out.data(), wetAudio.getReadPointer(0), dryAudio.getReadPointer(0),
+                               0.5f, 1.0f, 0.5f, 0.0f, numSamples);
+
+            for (int i = 0; i < numSamples; i++)
+            {
+                const float t = (float)i / numSamples;
+                const float expected = wetAudio.getSample(0, i) * (0.5f + 0.5f * t) +
+                                       dryAudio.getSample(0, i) * (0.5f - 0.5f * t);
+
+                REQUIRE(out[i] == Approx(expected).margin(1e-5));
+            }
+
+            // Nothing written past the end
+            CHECK(out[numSamples] == -1.0f);
+        }
+    }
+}
@@ -11,6 +11,7 @@
 #include "PluginProcessor.h"
 #include "PreDelay.h"
 
+#include <algorithm>
 #include <chrono>
 
 /**
@@ -31,13 +32,17 @@ public:
     float getDelayMs() { return delayMs; }
 
     constexpr int getMaxDelayMs() { return MAX_DELAY_MS; }
+
+    const float* getDelayLineData() const { return delayLine.getReadPointer(0); }
+    int getDelayLineNumSamples() const { return delayLine.getNumSamples(); }
 };
 
-TEST_CASE("Use a PreDelay object to manipulate an impulse response", "[PreDelay]") {
+TEST_CASE("Use a PreDelay object to delay the wet signal", "[PreDelay]") {
     constexpr int SAMPLE_RATE = 88200;
-    constexpr int NUM_CHANNELS = 1;
+    constexpr int NUM_CHANNELS = 2;
     constexpr std::chrono::milliseconds BLOCK_DURATION_MS(20);
     const int NUM_SAMPLES_PER_BLOCK = (int)std::ceil((BLOCK_DURATION_MS.count() / 1000.0) * SAMPLE_RATE);
+    constexpr int NUM_BLOCKS = 10;
 
     // Create PreDelay object
     reverb::AudioProcessor processor;
@@ -47,75 +52,172 @@ TEST_CASE("Use a PreDelay object to manipulate an impulse response", "[PreDelay]
     REQUIRE(processor.getSampleRate() == SAMPLE_RATE);
 
     PreDelayMocked preDelay(&processor);
+    preDelay.prepare(NUM_SAMPLES_PER_BLOCK, SAMPLE_RATE);
     preDelay.updateSampleRate(SAMPLE_RATE);
 
-    // Prepare dummy IR
-    constexpr int IR_SIZE = 2048;
-    constexpr float IR_VAL_OFFSET = 1000000.0f;
+    // Prepare input signal: ramp, different for each channel
+    constexpr float VAL_OFFSET = 1000.0f;
+    const int NUM_SAMPLES = NUM_BLOCKS * NUM_SAMPLES_PER_BLOCK;
 
-    juce::AudioSampleBuffer ir(1, IR_SIZE);
+    juce::AudioSampleBuffer input(NUM_CHANNELS, NUM_SAMPLES);
 
-    for (int i = 0; i < IR_SIZE; ++i)
+    for (int ch = 0; ch < NUM_CHANNELS; ++ch)
     {
-        ir.setSample(0, i, IR_VAL_OFFSET + i);
+        for (int i = 0; i < NUM_SAMPLES; ++i)
+        {
+            input.setSample(ch, i, VAL_OFFSET * (ch + 1) + i);
+        }
     }
 
+    // Run input through pre-delay, block by block
+    auto processBlocks = [&](int blockSize) {
+        juce::AudioSampleBuffer output(input);
+
+        for (int start = 0; start < NUM_SAMPLES; start += blockSize)
+        {
+            reverb::AudioBlock block(output);
+            preDelay.exec(block.getSubBlock((size_t)start, (size_t)std::min(blockSize, NUM_SAMPLES - start)));
+        }
+
+        return output;
+    };
+
+    auto expectedSample = [&](int ch, int i, int delaySamples) {
+        return (i < delaySamples) ? 0.0f : VAL_OFFSET * (ch + 1) + (i - delaySamples);
+    };
 
-    SECTION("When delay is 0, IR buffer should remain unchanged") {
+
+    SECTION("When delay is 0, signal should remain unchanged") {
         preDelay.setDelayMs(0);
 
         REQUIRE(preDelay.getDelayMs() == 0);
 
-        preDelay.prepareIR(ir);
-        preDelay.exec(ir);
-
-        CHECK(ir.getNumChannels() == 1);
-        CHECK(ir.getNumSamples() == IR_SIZE);
+        auto output = processBlocks(NUM_SAMPLES_PER_BLOCK);
 
-        for (int i = 0; i < IR_SIZE; ++i)
+        for (int ch = 0; ch < NUM_CHANNELS; ++ch)
         {
-            CHECK(ir.getSample(0, i) == IR_VAL_OFFSET + i);
+            for (int i = 0; i < NUM_SAMPLES; ++i)
+            {
+                REQUIRE(output.getSample(ch, i) == input.getSample(ch, i));
+            }
         }
     }
 
 
-    SECTION("Add 1ms pre-delay to IR => prepend 89 empty samples to buffer") {
+    SECTION("Add 1ms pre-delay => signal delayed by 89 samples") {
         static constexpr double DELAY_S = 0.001;
         const int EXPECTED_NUM_SAMPLES = (int)std::ceil(SAMPLE_RATE * DELAY_S);
 
         preDelay.setDelayMs(DELAY_S * 1000);
 
         REQUIRE(preDelay.getDelayMs() == DELAY_S * 1000);
+        REQUIRE(preDelay.getDelaySamples() == EXPECTED_NUM_SAMPLES);
 
-        preDelay.prepareIR(ir);
-        preDelay.exec(ir);
+        auto output = processBlocks(NUM_SAMPLES_PER_BLOCK);
 
-        CHECK(ir.getNumChannels() == 1);
-        CHECK(ir.getNumSamples() == IR_SIZE + EXPECTED_NUM_SAMPLES);
+        for (int ch = 0; ch < NUM_CHANNELS; ++ch)
+        {
+            for (int i = 0; i < NUM_SAMPLES; ++i)
+            {
+                REQUIRE(output.getSample(ch, i) == expectedSample(ch, i, EXPECTED_NUM_SAMPLES));
+            }
+        }
+    }
+
+
+    SECTION("Maximum delay, with blocks larger than prepared for") {
+        const int EXPECTED_NUM_SAMPLES = (int)std::ceil(SAMPLE_RATE * preDelay.getMaxDelayMs() / 1000.0);
 
-        for (int i = 0; i < EXPECTED_NUM_SAMPLES; ++i)
+        preDelay.setDelayMs((float)preDelay.getMaxDelayMs());
+
+        REQUIRE(preDelay.getDelaySamples() == EXPECTED_NUM_SAMPLES);
+
+        auto output = processBlocks(3 * NUM_SAMPLES_PER_BLOCK + 7);
+
+        for (int ch = 0; ch < NUM_CHANNELS; ++ch)
         {
-            CHECK(ir.getSample(0, i) == 0);
+            for (int i = 0; i < NUM_SAMPLES; ++i)
+            {
+                REQUIRE(output.getSample(ch, i) == expectedSample(ch, i, EXPECTED_NUM_SAMPLES));
+            }
         }
+    }
+
 
-        for (int i = EXPECTED_NUM_SAMPLES; i < ir.getNumSamples(); ++i)
+    SECTION("Sample rate changes never reallocate the delay line") {
+        const float* delayLineData = preDelay.getDelayLineData();
+        const int delayLineNumSamples = preDelay.getDelayLineNumSamples();
+
+        preDelay.setDelayMs((float)preDelay.getMaxDelayMs());
+
+        // Lower rate: the delay line is already long enough
+        preDelay.prepare(NUM_SAMPLES_PER_BLOCK, SAMPLE_RATE / 2);
+        preDelay.updateSampleRate(SAMPLE_RATE / 2);
+
+        CHECK(preDelay.getDelayLineData() == delayLineData);
+        CHECK(preDelay.getDelaySamples() == (int)std::ceil(SAMPLE_RATE / 2 * preDelay.getMaxDelayMs() / 1000.0));
+
+        // Higher rate without being prepared for it: the delay is shortened instead
+        preDelay.updateSampleRate(SAMPLE_RATE * 2);
+
+        CHECK(preDelay.getDelayLineData() == delayLineData);
+        CHECK(preDelay.getDelaySamples() == delayLineNumSamples - NUM_SAMPLES_PER_BLOCK);
+
+        // Until it is
+        preDelay.prepare(NUM_SAMPLES_PER_BLOCK, SAMPLE_RATE * 2);
+
+        CHECK(preDelay.getDelaySamples() == (int)std::ceil(SAMPLE_RATE * 2 * preDelay.getMaxDelayMs() / 1000.0));
+    }
+
+
+    SECTION("Delay change crossfades over one block") {
+        constexpr int DELAY_1 = 100;
+        constexpr int DELAY_2 = 300;
+
+        juce::AudioSampleBuffer output(input);
+        reverb::AudioBlock block(output);
+
+        preDelay.setDelayMs(DELAY_1 * 1000.0f / SAMPLE_RATE);
+        REQUIRE(preDelay.getDelaySamples() == DELAY_1);
+
+        preDelay.exec(block.getSubBlock(0, (size_t)NUM_SAMPLES_PER_BLOCK));
+
+        preDelay.setDelayMs(DELAY_2 * 1000.0f / SAMPLE_RATE);
+        REQUIRE(preDelay.getDelaySamples() == DELAY_2);
+
+        preDelay.exec(block.getSubBlock((size_t)NUM_SAMPLES_PER_BLOCK, (size_t)NUM_SAMPLES_PER_BLOCK));
+        preDelay.exec(block.getSubBlock((size_t)(2 * NUM_SAMPLES_PER_BLOCK), (size_t)NUM_SAMPLES_PER_BLOCK));
+
+        for (int ch = 0; ch < NUM_CHANNELS; ++ch)
         {
-            CHECK(ir.getSample(0, i) == IR_VAL_OFFSET + (i - EXPECTED_NUM_SAMPLES));
+            for (int i = 0; i < NUM_SAMPLES_PER_BLOCK; ++i)
+            {
+                const float fade = (float)i / NUM_SAMPLES_PER_BLOCK;
+                const int j = NUM_SAMPLES_PER_BLOCK + i;
+
+                const float expected = expectedSample(ch, j, DELAY_1) +
+                                       fade * (expectedSample(ch, j, DELAY_2) - expectedSample(ch, j, DELAY_1));
+
+                REQUIRE(output.getSample(ch, j) == Approx(expected));
+                REQUIRE(output.getSample(ch, j + NUM_SAMPLES_PER_BLOCK) ==
+                        expectedSample(ch, j + NUM_SAMPLES_PER_BLOCK, DELAY_2));
+            }
         }
     }
-  
+
 
     SECTION("Performance_Testing") {
         constexpr std::chrono::microseconds MAX_EXEC_TIME_US(1000);
         static constexpr double DELAY_S = 1;
-        const int EXPECTED_NUM_SAMPLES = (int)std::ceil(SAMPLE_RATE * DELAY_S);
 
         preDelay.setDelayMs(DELAY_S * 1000);
 
+        juce::AudioSampleBuffer audio(input);
+        reverb::AudioBlock block(audio);
+
         // Measure exec time
         auto start = std::chrono::high_resolution_clock::now();
-        preDelay.prepareIR(ir);
-        preDelay.exec(ir);
+        preDelay.exec(block.getSubBlock(0, (size_t)NUM_SAMPLES_PER_BLOCK));
         auto end = std::chrono::high_resolution_clock::now();
 
         auto execTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
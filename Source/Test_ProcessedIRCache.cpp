@@ -0,0 +1,116 @@
+/*
+  ==============================================================================
+
+    Test_ProcessedIRCache.cpp
+
+  ==============================================================================
+*/
+
+#include "catch.hpp"
+
+#include "ProcessedIRCache.h"
+
+#include <cmath>
+
+/**
+ * How to write tests with Catch:
+ * https://github.com/catchorg/Catch2/blob/2bbba4f5444b7a90fcba92562426c14b11e87b76/docs/tutorial.md#writing-tests
+ */
+
+TEST_CASE("Processed IRs are kept on disk", "[ProcessedIRCache]") {
+    constexpr int NUM_CHANNELS = 4;
+    constexpr int NUM_SAMPLES = 10000;
+    constexpr int NUM_SOURCE_CHANNELS = 2;
+
+    const auto directory = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                               .getChildFile("quantumVERB_Test_ProcessedIRCache");
+    directory.deleteRecursively();
+
+    juce::AudioSampleBuffer ir(NUM_CHANNELS, NUM_SAMPLES);
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+    {
+        for (int i = 0; i < NUM_SAMPLES; ++i)
+        {
+            ir.setSample(channel, i, (channel + 1) * 0.1f * std::sin(0.01f * i));
+        }
+    }
+
+    reverb::ProcessedIRCache::Key key;
+    key.irNameOrFilePath = "large_hall_wav";
+    key.numChannels = 2;
+    key.sampleRate = 48000.0;
+    key.irLengthS = 3.0f;
+
+    {
+        reverb::ProcessedIRCache cache(directory);
+
+        cache.store(key, ir, NUM_SOURCE_CHANNELS);
+        cache.waitForPendingStores();
+
+        REQUIRE(cache.getFile(key).existsAsFile());
+    }
+
+    // Entries outlive the cache object (i.e. the session)
+    reverb::ProcessedIRCache cache(directory);
+
+    SECTION("Stored IRs are read back") {
+        juce::AudioSampleBuffer cachedIR;
+        int numSourceChannels = 0;
+
+        REQUIRE(cache.load(key, cachedIR, numSourceChannels));
+
+        CHECK(numSourceChannels == NUM_SOURCE_CHANNELS);
+        REQUIRE(cachedIR.getNumChannels() == NUM_CHANNELS);
+        REQUIRE(cachedIR.getNumSamples() == NUM_SAMPLES);
+
+        for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+        {
+            for (int i = 0; i < NUM_SAMPLES; i += 97)
+            {
+                CHECK(cachedIR.getSample(channel, i) == ir.getSample(channel, i));
+            }
+        }
+    }
+
+    SECTION("Any IR-affecting change is a miss") {
+        juce::AudioSampleBuffer cachedIR;
+        int numSourceChannels = 0;
+
+        auto otherKey = key;
+        otherKey.irLengthS = 3.5f;
+        CHECK_FALSE(cache.load(otherKey, cachedIR, numSourceChannels));
+
+        otherKey = key;
+        otherKey.sampleRate = 44100.0;
+        CHECK_FALSE(cache.load(otherKey, cachedIR, numSourceChannels));
+
+        otherKey = key;
+        otherKey.irVersion = 1;
+        CHECK_FALSE(cache.load(otherKey, cachedIR, numSourceChannels));
+
+        otherKey = key;
+        otherKey.lengthMode = 1;
+        CHECK_FALSE(cache.load(otherKey, cachedIR, numSourceChannels));
+
+        // Banked IR replaced by another one with the same format
+        otherKey = key;
+        otherKey.irContentHash = "0123456789abcdef";
+        CHECK_FALSE(cache.load(otherKey, cachedIR, numSourceChannels));
+
+        CHECK(cachedIR.getNumSamples() == 0);
+    }
+
+    SECTION("Invalid entries are discarded") {
+        const auto file = cache.getFile(key);
+        const auto truncated = file.loadFileAsData();
+        file.replaceWithData(truncated.getData(), truncated.getSize() / 2);
+
+        juce::AudioSampleBuffer cachedIR;
+        int numSourceChannels = 0;
+
+        CHECK_FALSE(cache.load(key, cachedIR, numSourceChannels));
+        CHECK_FALSE(file.exists());
+    }
+
+    directory.deleteRecursively();
+}
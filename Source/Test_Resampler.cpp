@@ -0,0 +1,158 @@
+/*
+  ==============================================================================
+
+    Test_Resampler.cpp
+
+  ==============================================================================
+*/
+
+#include "catch.hpp"
+
+#include "Resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+ * How to write tests with Catch:
+ * https://github.com/catchorg/Catch2/blob/2bbba4f5444b7a90fcba92562426c14b11e87b76/docs/tutorial.md#writing-tests
+ */
+
+//==============================================================================
+/**
+ * @brief Returns a sine wave
+ */
+static std::vector<float> makeSine(double frequency, double sampleRate, int numSamples)
+{
+    std::vector<float> sine(numSamples);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        sine[i] = (float)std::sin(2.0 * juce::MathConstants<double>::pi * frequency * i / sampleRate);
+    }
+
+    return sine;
+}
+
+TEST_CASE("Convert signals between sample rates", "[Resampler]") {
+    constexpr int NUM_SAMPLES = 44100;
+
+    // Ignore edges, where the filter runs into the silence around the signal
+    constexpr int EDGE_SAMPLES = 2000;
+
+    SECTION("Upsampling preserves in-band signals") {
+        constexpr double SOURCE_RATE = 44100.0;
+        constexpr double TARGET_RATE = 96000.0;
+        constexpr double FREQUENCY = 5000.0;
+
+        const auto source = makeSine(FREQUENCY, SOURCE_RATE, NUM_SAMPLES);
+
+        reverb::Resampler resampler(SOURCE_RATE, TARGET_RATE);
+
+        const int numDestSamples = resampler.getOutputNumSamples(NUM_SAMPLES);
+        REQUIRE(numDestSamples == 96000);
+
+        std::vector<float> dest(numDestSamples);
+        resampler.process(source.data(), NUM_SAMPLES, dest.data(), numDestSamples);
+
+        const auto expected = makeSine(FREQUENCY, TARGET_RATE, numDestSamples);
+
+        float maxError = 0.0f;
+        for (int i = EDGE_SAMPLES; i < numDestSamples - EDGE_SAMPLES; ++i)
+        {
+            maxError = std::max(maxError, std::abs(dest[i] - expected[i]));
+        }
+
+        CHECK(maxError < 1e-3f);
+    }
+
+    SECTION("Downsampling removes frequencies above the target Nyquist frequency") {
+        constexpr double SOURCE_RATE = 96000.0;
+        constexpr double TARGET_RATE = 44100.0;
+
+        reverb::Resampler resampler(SOURCE_RATE, TARGET_RATE);
+
+        const int numDestSamples = resampler.getOutputNumSamples(NUM_SAMPLES);
+        std::vector<float> dest(numDestSamples);
+
+        // In band: preserved
+        const auto inBand = makeSine(1000.0, SOURCE_RATE, NUM_SAMPLES);
+        resampler.process(inBand.data(), NUM_SAMPLES, dest.data(), numDestSamples);
+
+        const auto expected = makeSine(1000.0, TARGET_RATE, numDestSamples);
+
+        float maxError = 0.0f;
+        for (int i = EDGE_SAMPLES; i < numDestSamples - EDGE_SAMPLES; ++i)
+        {
+            maxError = std::max(maxError, std::abs(dest[i] - expected[i]));
+        }
+
+        CHECK(maxError < 1e-3f);
+
+        // Out of band: would alias to 14.1 kHz without filtering
+        const auto outOfBand = makeSine(30000.0, SOURCE_RATE, NUM_SAMPLES);
+        resampler.process(outOfBand.data(), NUM_SAMPLES, dest.data(), numDestSamples);
+
+        float maxAmplitude = 0.0f;
+        for (int i = EDGE_SAMPLES; i < numDestSamples - EDGE_SAMPLES; ++i)
+        {
+            maxAmplitude = std::max(maxAmplitude, std::abs(dest[i]));
+        }
+
+        CHECK(maxAmplitude < 1e-3f);
+    }
+
+    SECTION("All channels of a buffer are converted") {
+        juce::AudioSampleBuffer source(2, NUM_SAMPLES);
+        source.clear();
+        source.setSample(1, NUM_SAMPLES / 2, 1.0f);
+
+        juce::AudioSampleBuffer dest;
+        reverb::Resampler(44100.0, 48000.0).process(source, dest);
+
+        CHECK(dest.getNumChannels() == 2);
+        CHECK(dest.getNumSamples() == 48000);
+        CHECK(dest.getMagnitude(0, 0, dest.getNumSamples()) == 0.0f);
+        CHECK(dest.getMagnitude(1, 0, dest.getNumSamples()) > 0.5f);
+    }
+
+    SECTION("Converting in sections gives the same signal as in one go") {
+        constexpr int SECTION_NUM_SAMPLES = 1000;
+
+        juce::Random random(42);
+        std::vector<float> source(NUM_SAMPLES);
+
+        for (auto& sample : source)
+        {
+            sample = random.nextFloat() * 2.0f - 1.0f;
+        }
+
+        for (const double targetRate : { 32000.0, 96000.0 })
+        {
+            reverb::Resampler resampler(44100.0, targetRate);
+
+            const int numDestSamples = resampler.getOutputNumSamples(NUM_SAMPLES);
+
+            std::vector<float> expected(numDestSamples);
+            resampler.process(source.data(), NUM_SAMPLES, expected.data(), numDestSamples);
+
+            // Each section only gets the input samples it needs
+            std::vector<float> dest(numDestSamples);
+
+            for (int start = 0; start < numDestSamples; start += SECTION_NUM_SAMPLES)
+            {
+                const juce::Range<int> destRange(start, std::min(start + SECTION_NUM_SAMPLES, numDestSamples));
+                const juce::Range<int> sourceRange = resampler.getInputRange(destRange, NUM_SAMPLES);
+
+                const std::vector<float> sourceSection(source.begin() + sourceRange.getStart(),
+                                                       source.begin() + sourceRange.getEnd());
+
+                resampler.process(sourceSection.data(), sourceRange, NUM_SAMPLES,
+                                  dest.data() + start, destRange);
+            }
+
+            CHECK(dest == expected);
+        }
+    }
+}
@@ -10,6 +10,7 @@
 
 #include "PluginProcessor.h"
 #include "TimeStretch.h"
+#include "WorkerPool.h"
 
 #include <algorithm>
 #include <chrono>
@@ -28,8 +29,30 @@ public:
 
     float getIRLengthS() { return irLengthS; }
     static constexpr double getMaxIRLengthS() { return MAX_IR_LENGTH_S; }
+
+    using TimeStretch::estimateDecayRate;
+    using TimeStretch::getNumSegments;
 };
 
+//==============================================================================
+/**
+ * Fills a buffer with exponentially decaying noise (-60 dB after t60 samples)
+ */
+static void fillDecayingNoise(juce::AudioSampleBuffer& buffer, double t60)
+{
+    juce::Random random(42);
+    const double decayRate = std::log(1000.0) / t60;
+
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    {
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            const float noise = random.nextFloat() * 2.0f - 1.0f;
+            buffer.setSample(channel, i, noise * (float)std::exp(-decayRate * i));
+        }
+    }
+}
+
 TEST_CASE("Use a TimeStretch object to manipulate a buffer", "[TimeStretch]") {
     constexpr int SAMPLE_RATE = 88200;
     constexpr int NUM_CHANNELS = 1;
@@ -109,3 +132,252 @@ TEST_CASE("Use a TimeStretch object to manipulate a buffer", "[TimeStretch]") {
     }
 
 }
+
+TEST_CASE("Change IR length by reshaping its decay envelope", "[TimeStretch]") {
+    constexpr int SAMPLE_RATE = 48000;
+    constexpr int NUM_CHANNELS = 2;
+    constexpr int NUM_SAMPLES_PER_BLOCK = 512;
+    constexpr double IR_ORIG_LENGTH_S = 2.0;
+    constexpr double IR_ORIG_T60_S = 1.0;
+
+    reverb::AudioProcessor processor;
+    processor.setPlayConfigDetails(NUM_CHANNELS, NUM_CHANNELS,
+                                   SAMPLE_RATE, NUM_SAMPLES_PER_BLOCK);
+
+    TimeStretchMocked timeStretch(&processor);
+    timeStretch.updateSampleRate(SAMPLE_RATE);
+    timeStretch.setLengthMode(reverb::TimeStretch::LengthMode::Envelope);
+
+    juce::AudioSampleBuffer irOrig(NUM_CHANNELS, (int)(IR_ORIG_LENGTH_S * SAMPLE_RATE));
+    fillDecayingNoise(irOrig, IR_ORIG_T60_S * SAMPLE_RATE);
+
+    const double origDecayRate = TimeStretchMocked::estimateDecayRate(irOrig.getReadPointer(0),
+                                                                      irOrig.getNumSamples());
+
+    CHECK(origDecayRate == Approx(std::log(1000.0) / (IR_ORIG_T60_S * SAMPLE_RATE)).epsilon(0.1));
+
+    double irTargetLengthS = 0.0;
+
+    SECTION("Shorten IR") {
+        irTargetLengthS = 0.5;
+    }
+
+    SECTION("Lengthen IR") {
+        irTargetLengthS = 1.5;
+    }
+
+    SECTION("Lengthen IR beyond original length") {
+        irTargetLengthS = 3.0;
+    }
+
+    auto irLength = processor.parameters.getParameterAsValue(processor.PID_IR_LENGTH);
+    irLength.setValue(irTargetLengthS);
+
+    timeStretch.updateParams(processor.parameters, processor.PID_IR_LENGTH);
+
+    juce::AudioSampleBuffer ir;
+    ir.makeCopyOf(irOrig);
+
+    timeStretch.prepareIR(ir);
+    timeStretch.exec(ir);
+
+    // Same output length as time stretching
+    REQUIRE(ir.getNumSamples() == timeStretch.getOutputNumSamples());
+    CHECK_FALSE(timeStretch.needsToRun());
+
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+    {
+        // Direct sound is kept, and the IR decays by 60 dB over its new length
+        CHECK(ir.getSample(channel, 0) == Approx(irOrig.getSample(channel, 0)));
+
+        const double decayRate = TimeStretchMocked::estimateDecayRate(ir.getReadPointer(channel),
+                                                                      ir.getNumSamples());
+
+        CHECK(decayRate == Approx(std::log(1000.0) / ir.getNumSamples()).epsilon(0.15));
+        CHECK(ir.getMagnitude(channel, ir.getNumSamples() / 2, ir.getNumSamples() / 2) > 0.0f);
+    }
+}
+
+TEST_CASE("Extend short IRs with a tail that neither repeats nor drifts", "[TimeStretch]") {
+    constexpr int SAMPLE_RATE = 48000;
+    constexpr int NUM_CHANNELS = 2;
+    constexpr int NUM_SAMPLES_PER_BLOCK = 512;
+    constexpr double IR_TARGET_LENGTH_S = 5.0;
+    constexpr int MAX_LAG = SAMPLE_RATE / 20;
+
+    reverb::AudioProcessor processor;
+    processor.setPlayConfigDetails(NUM_CHANNELS, NUM_CHANNELS,
+                                   SAMPLE_RATE, NUM_SAMPLES_PER_BLOCK);
+
+    TimeStretchMocked timeStretch(&processor);
+    timeStretch.updateSampleRate(SAMPLE_RATE);
+    timeStretch.setLengthMode(reverb::TimeStretch::LengthMode::Envelope);
+
+    int irOrigNumSamples = 0;
+
+    SECTION("Short IR") {
+        // Only a few ms of the IR are kept, the rest of the 5 s is synthesised
+        irOrigNumSamples = SAMPLE_RATE / 10;
+    }
+
+    SECTION("IR too short to draw grains from") {
+        irOrigNumSamples = 32;
+    }
+
+    juce::AudioSampleBuffer irOrig(NUM_CHANNELS, irOrigNumSamples);
+    fillDecayingNoise(irOrig, irOrigNumSamples);
+
+    auto irLength = processor.parameters.getParameterAsValue(processor.PID_IR_LENGTH);
+    irLength.setValue(IR_TARGET_LENGTH_S);
+
+    timeStretch.updateParams(processor.parameters, processor.PID_IR_LENGTH);
+
+    juce::AudioSampleBuffer ir;
+    ir.makeCopyOf(irOrig);
+
+    timeStretch.prepareIR(ir);
+    timeStretch.exec(ir);
+
+    REQUIRE(ir.getNumSamples() == timeStretch.getOutputNumSamples());
+
+    const int numSamples = ir.getNumSamples();
+    const double newDecayRate = std::log(1000.0) / numSamples;
+
+    // One second of the synthesised tail, with its decay taken out
+    const int tailStart = SAMPLE_RATE;
+    const int tailSize = SAMPLE_RATE;
+    REQUIRE(tailStart + tailSize + MAX_LAG <= numSamples);
+
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+    {
+        const double decayRate = TimeStretchMocked::estimateDecayRate(ir.getReadPointer(channel), numSamples);
+        CHECK(decayRate == Approx(newDecayRate).epsilon(0.15));
+
+        std::vector<double> tail((size_t)(tailSize + MAX_LAG));
+
+        for (size_t i = 0; i < tail.size(); ++i)
+        {
+            const int index = tailStart + (int)i;
+            tail[i] = ir.getSample(channel, index) * std::exp(newDecayRate * index);
+        }
+
+        double mean = 0.0;
+        double energy = 0.0;
+
+        for (int i = 0; i < tailSize; ++i)
+        {
+            mean += tail[i];
+            energy += tail[i] * tail[i];
+        }
+
+        mean /= tailSize;
+        REQUIRE(energy > 0.0);
+
+        // No DC
+        CHECK(std::abs(mean) < 0.02 * std::sqrt(energy / tailSize));
+
+        // No periodicity: normalised autocorrelation stays low at all lags
+        double maxCorrelation = 0.0;
+
+        for (int lag = 1; lag <= MAX_LAG; ++lag)
+        {
+            double correlation = 0.0;
+
+            for (int i = 0; i < tailSize; ++i)
+            {
+                correlation += tail[i] * tail[i + lag];
+            }
+
+            maxCorrelation = std::max(maxCorrelation, std::abs(correlation) / energy);
+        }
+
+        CHECK(maxCorrelation < 0.2);
+    }
+}
+
+TEST_CASE("Stretch long IRs in segments on a worker pool", "[TimeStretch]") {
+    constexpr int SAMPLE_RATE = 48000;
+    constexpr int NUM_CHANNELS = 2;
+    constexpr int NUM_SAMPLES_PER_BLOCK = 512;
+    constexpr int NUM_WORKERS = 3;
+    constexpr double IR_ORIG_LENGTH_S = 3.0;
+    constexpr double SINE_FREQUENCY = 220.0;
+    constexpr float SINE_AMPLITUDE = 0.5f;
+
+    reverb::AudioProcessor processor;
+    processor.setPlayConfigDetails(NUM_CHANNELS, NUM_CHANNELS,
+                                   SAMPLE_RATE, NUM_SAMPLES_PER_BLOCK);
+
+    reverb::WorkerPool pool(NUM_WORKERS, false);
+
+    TimeStretchMocked timeStretch(&processor);
+    timeStretch.updateSampleRate(SAMPLE_RATE);
+    timeStretch.setWorkerPool(&pool);
+
+    // Sine input (one phase per channel): segments must join without clicks or dips
+    juce::AudioSampleBuffer irOrig(NUM_CHANNELS, (int)(IR_ORIG_LENGTH_S * SAMPLE_RATE));
+
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+    {
+        for (int i = 0; i < irOrig.getNumSamples(); ++i)
+        {
+            const double phase = 2.0 * juce::MathConstants<double>::pi * SINE_FREQUENCY * i / SAMPLE_RATE;
+            irOrig.setSample(channel, i, SINE_AMPLITUDE * (float)std::sin(phase + channel));
+        }
+    }
+
+    double irTargetLengthS = 0.0;
+
+    SECTION("Stretch") {
+        irTargetLengthS = 4.0;
+    }
+
+    SECTION("Compress") {
+        irTargetLengthS = 2.0;
+    }
+
+    auto irLength = processor.parameters.getParameterAsValue(processor.PID_IR_LENGTH);
+    irLength.setValue(irTargetLengthS);
+
+    timeStretch.updateParams(processor.parameters, processor.PID_IR_LENGTH);
+
+    REQUIRE(timeStretch.getNumSegments(timeStretch.getOutputNumSamples()) == NUM_WORKERS + 1);
+
+    juce::AudioSampleBuffer ir;
+    ir.makeCopyOf(irOrig);
+
+    timeStretch.prepareIR(ir);
+    timeStretch.exec(ir);
+
+    // Same output length as stretching in one piece
+    REQUIRE(ir.getNumChannels() == NUM_CHANNELS);
+    REQUIRE(ir.getNumSamples() == timeStretch.getOutputNumSamples());
+
+    // No jumps (the sine's slope is at most 2 pi f A / fs per sample), and no dips where
+    // segments are crossfaded (ignoring the end, which SoundTouch pads when flushing)
+    const float maxStep = 2.0f * (float)(2.0 * juce::MathConstants<double>::pi * SINE_FREQUENCY *
+                                         SINE_AMPLITUDE / SAMPLE_RATE) + 0.01f;
+    const int windowSize = SAMPLE_RATE / 100;
+    const int numCheckedSamples = ir.getNumSamples() - SAMPLE_RATE / 10;
+
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+    {
+        float maxDiff = 0.0f;
+
+        for (int i = 1; i < numCheckedSamples; ++i)
+        {
+            maxDiff = std::max(maxDiff, std::abs(ir.getSample(channel, i) - ir.getSample(channel, i - 1)));
+        }
+
+        CHECK(maxDiff <= maxStep);
+
+        float minPeak = SINE_AMPLITUDE;
+
+        for (int start = 0; start + windowSize <= numCheckedSamples; start += windowSize / 2)
+        {
+            minPeak = std::min(minPeak, ir.getMagnitude(channel, start, windowSize));
+        }
+
+        CHECK(minPeak >= 0.8f * SINE_AMPLITUDE);
+    }
+}
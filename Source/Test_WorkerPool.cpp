@@ -0,0 +1,187 @@
+/*
+  ==============================================================================
+
+    Test_WorkerPool.cpp
+
+  ==============================================================================
+*/
+
+#include "catch.hpp"
+
+#include "WorkerPool.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/**
+ * How to write tests with Catch:
+ * https://github.com/catchorg/Catch2/blob/2bbba4f5444b7a90fcba92562426c14b11e87b76/docs/tutorial.md#writing-tests
+ */
+
+namespace
+{
+    constexpr int MAX_NUM_JOBS = 8;
+
+    struct JobCounters
+    {
+        std::array<std::atomic<int>, MAX_NUM_JOBS> counts;
+    };
+
+    void countJob(void* context, int jobIdx)
+    {
+        static_cast<JobCounters*>(context)->counts[jobIdx]++;
+    }
+}
+
+TEST_CASE("WorkerPool runs every job exactly once per batch", "[WorkerPool]") {
+    constexpr int NUM_BATCHES = 10000;
+
+    int numWorkers = 0;
+    bool isRealtime = true;
+
+    SECTION("No workers (caller runs every job)") {
+        numWorkers = 0;
+    }
+
+    SECTION("Three workers") {
+        numWorkers = 3;
+    }
+
+    SECTION("Three background workers (caller sleeps until the last job is done)") {
+        numWorkers = 3;
+        isRealtime = false;
+    }
+
+    reverb::WorkerPool pool(numWorkers, isRealtime);
+    REQUIRE(pool.getNumWorkers() == numWorkers);
+
+    JobCounters counters;
+    for (auto& count : counters.counts)
+    {
+        count = 0;
+    }
+
+    std::array<int, MAX_NUM_JOBS> expectedCounts {};
+
+    for (int batch = 0; batch < NUM_BATCHES; ++batch)
+    {
+        const int numJobs = 1 + batch % MAX_NUM_JOBS;
+
+        pool.run(numJobs, countJob, &counters);
+
+        for (int i = 0; i < numJobs; ++i)
+        {
+            expectedCounts[i]++;
+        }
+    }
+
+    for (int i = 0; i < MAX_NUM_JOBS; ++i)
+    {
+        CHECK(counters.counts[i] == expectedCounts[i]);
+    }
+}
+
+TEST_CASE("WorkerPool wakes up parked workers", "[WorkerPool]") {
+    constexpr int NUM_JOBS = 4;
+
+    reverb::WorkerPool pool(NUM_JOBS - 1);
+
+    JobCounters counters;
+    for (auto& count : counters.counts)
+    {
+        count = 0;
+    }
+
+    // Leave enough time between batches for workers to stop spinning and park
+    for (int batch = 1; batch <= 5; ++batch)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        pool.run(NUM_JOBS, countJob, &counters);
+
+        for (int i = 0; i < NUM_JOBS; ++i)
+        {
+            CHECK(counters.counts[i] == batch);
+        }
+    }
+}
+
+TEST_CASE("A background WorkerPool can be shared by several threads", "[WorkerPool]") {
+    constexpr int NUM_CALLERS = 3;
+    constexpr int NUM_BATCHES = 2000;
+
+    reverb::WorkerPool pool(3, false);
+
+    // Each caller runs its own jobs, so batches must neither mix nor overlap
+    std::array<JobCounters, NUM_CALLERS> counters;
+    for (auto& callerCounters : counters)
+    {
+        for (auto& count : callerCounters.counts)
+        {
+            count = 0;
+        }
+    }
+
+    std::array<std::thread, NUM_CALLERS> callers;
+    for (int i = 0; i < NUM_CALLERS; ++i)
+    {
+        callers[i] = std::thread([&pool, &counters, i]() {
+            for (int batch = 0; batch < NUM_BATCHES; ++batch)
+            {
+                pool.run(MAX_NUM_JOBS, countJob, &counters[i]);
+            }
+        });
+    }
+
+    for (auto& caller : callers)
+    {
+        caller.join();
+    }
+
+    for (const auto& callerCounters : counters)
+    {
+        for (const auto& count : callerCounters.counts)
+        {
+            CHECK(count == NUM_BATCHES);
+        }
+    }
+}
+
+TEST_CASE("Realtime WorkerPool workers only park once batches stop", "[WorkerPool]") {
+    constexpr int NUM_JOBS = 4;
+
+    reverb::WorkerPool pool(NUM_JOBS - 1);
+
+    JobCounters counters;
+    for (auto& count : counters.counts)
+    {
+        count = 0;
+    }
+
+    // Batches coming in faster than the spin time keep workers awake
+    pool.setSpinTime(1.0);
+
+    for (int batch = 1; batch <= 5; ++batch)
+    {
+        pool.run(NUM_JOBS, countJob, &counters);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        CHECK(pool.getNumParkedWorkers() == 0);
+    }
+
+    // Once they stop for longer, workers park...
+    pool.setSpinTime(0.01);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    CHECK(pool.getNumParkedWorkers() == NUM_JOBS - 1);
+
+    // ...and are woken up by the next batch
+    pool.run(NUM_JOBS, countJob, &counters);
+
+    for (int i = 0; i < NUM_JOBS; ++i)
+    {
+        CHECK(counters.counts[i] == 6);
+    }
+}
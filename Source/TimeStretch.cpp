@@ -10,6 +10,7 @@
 #include "Logger.h"
 
 #include <algorithm>
+#include <cmath>
 #include <thread>
 
 namespace reverb
@@ -28,9 +29,10 @@ namespace reverb
     TimeStretch::TimeStretch(juce::AudioProcessor * processor)
         : Task(processor)
     {
-        soundtouch.reset(new soundtouch::SoundTouch());
+        segments.resize(1);
+        segments[0].soundtouch.reset(new soundtouch::SoundTouch());
         
-        if (!soundtouch)
+        if (!segments[0].soundtouch)
         {
             logger.dualPrint(Logger::Level::Error, "Failed to create SoundTouch handle");
         }
@@ -54,39 +56,244 @@ namespace reverb
         }
     }
 
+    /**
+     * @brief Selects how the IR length is changed
+     *
+     * @param [in] mode Length mode
+     */
+    void TimeStretch::setLengthMode(LengthMode mode)
+    {
+        if (mode != lengthMode)
+        {
+            lengthMode = mode;
+            mustExec = true;
+        }
+    }
+
+    //==============================================================================
+    /**
+     * @brief Change the length of the input IR buffer
+     *
+     * Depending on the length mode, either time stretches the IR or reshapes its decay
+     * envelope (see reshapeEnvelope()).
+     *
+     * NOTE: prepareIR() method should be called before to manage buffer size. This
+     *       will take over (or share) the original IR and resize the given buffer to
+     *       the appropriate size based on sample rate and desired length.
+     *
+     * @param [in,out] ir   Audio sample buffer to process
+     */
+    AudioBlock TimeStretch::exec(AudioBlock ir)
+    {
+        switch (lengthMode)
+        {
+            case LengthMode::Envelope:
+                reshapeEnvelope(ir);
+                break;
+
+            case LengthMode::SoundTouch:
+            default:
+                stretch(ir);
+                break;
+        }
+
+        // Input is not needed anymore: don't hold on to the IR
+        irOrig.reset();
+
+        // Reset mustExec flag
+        mustExec = false;
+
+        return ir;
+    }
+
     //==============================================================================
     /**
      * @brief Apply time stretching algorithm to input IR buffer to change sample rate
      * 
      * Stretch or compress input buffer by a factor proportional to original and desired
-     * sample rates.
+     * sample rates. All channels are processed at once.
      *
-     * NOTE: prepareIR() method should be called before to manage buffer size. This
-     *       will copy the original IR and resize the given buffer to the appropriate
-     *       size based on sample rate and desired length.
+     * Long IRs are split into segments that are stretched in parallel on the worker pool,
+     * if any. Each segment is stretched with extra margins on both sides, shifted to line
+     * up with the previous one, then crossfaded into it. A single segment is stretched in
+     * one piece, without margins.
      *
      * @param [in,out] ir   Audio sample buffer to process
+     *
+     * @throws std::runtime_error
      */
-    AudioBlock TimeStretch::exec(AudioBlock ir)
+    void TimeStretch::stretch(AudioBlock ir)
+    {
+        numStretchChannels = (int)ir.getNumChannels();
+        jassert(numStretchChannels == irOrig->getNumChannels());
+
+        const int numSamples = irOrig->getNumSamples();
+        const int newNumSamples = (int)ir.getNumSamples();
+
+        ir.clear();
+
+        if (numSamples == 0 || newNumSamples == 0)
+        {
+            return;
+        }
+
+        // Calculate tempo change
+        tempo = (double)numSamples / (double)newNumSamples;
+
+        // Split output into segments, and find the input each of them needs (including
+        // crossfades and margins)
+        const int numSegments = getNumSegments(newNumSamples);
+        const int margin = (int)(SEGMENT_MARGIN_S * sampleRate);
+        const int crossfadeLength = (int)(SEGMENT_CROSSFADE_S * sampleRate);
+
+        auto getBoundary = [newNumSamples, numSegments](int segmentIdx)
+        {
+            return (int)((int64_t)newNumSamples * segmentIdx / numSegments);
+        };
+
+        while ((int)segments.size() < numSegments)
+        {
+            segments.emplace_back();
+            segments.back().soundtouch.reset(new soundtouch::SoundTouch());
+        }
+
+        for (int i = 0; i < numSegments; ++i)
+        {
+            Segment& segment = segments[i];
+
+            const int outputStart = getBoundary(i) - crossfadeLength / 2 - margin;
+            const int outputEnd = getBoundary(i + 1) + crossfadeLength / 2 + margin;
+
+            segment.inputStart = (i == 0) ? 0 : std::max((int)(outputStart * tempo), 0);
+            segment.inputEnd = (i == numSegments - 1) ? numSamples
+                                                      : std::min((int)std::ceil(outputEnd * tempo), numSamples);
+
+            segment.outputOffset = (int)std::lround(segment.inputStart / tempo);
+            segment.error = nullptr;
+        }
+
+        // Stretch segments (in parallel if possible)
+        if (workerPool && numSegments > 1)
+        {
+            workerPool->run(numSegments, &TimeStretch::stretchSegmentJob, this);
+        }
+        else
+        {
+            for (int i = 0; i < numSegments; ++i)
+            {
+                stretchSegmentJob(this, i);
+            }
+        }
+
+        for (int i = 0; i < numSegments; ++i)
+        {
+            if (segments[i].error)
+            {
+                std::rethrow_exception(segments[i].error);
+            }
+        }
+
+        // Line up each segment with the previous one
+        const int maxLag = std::min((int)(MAX_SEGMENT_ALIGNMENT_S * sampleRate), margin);
+
+        for (int i = 1; i < numSegments; ++i)
+        {
+            segments[i].outputOffset -= findAlignment(segments[i - 1], segments[i],
+                                                      getBoundary(i), crossfadeLength, maxLag);
+        }
+
+        // Stitch segments, crossfading around each boundary
+        for (int i = 0; i < numSegments; ++i)
+        {
+            const Segment& segment = segments[i];
+
+            const int fadeInStart = (i > 0) ? getBoundary(i) - crossfadeLength / 2 : 0;
+            const int fadeInEnd = (i > 0) ? fadeInStart + crossfadeLength : 0;
+            const int fadeOutStart = (i < numSegments - 1) ? getBoundary(i + 1) - crossfadeLength / 2
+                                                           : newNumSamples;
+            const int fadeOutEnd = (i < numSegments - 1) ? fadeOutStart + crossfadeLength
+                                                         : newNumSamples;
+
+            for (int channel = 0; channel < numStretchChannels; ++channel)
+            {
+                float* out = ir.getChannelPointer(channel);
+
+                for (int n = std::max(fadeInStart, 0); n < std::min(fadeOutEnd, newNumSamples); ++n)
+                {
+                    float gain = 1.0f;
+
+                    if (n < fadeInEnd)
+                    {
+                        gain = (n - fadeInStart + 0.5f) / crossfadeLength;
+                    }
+                    else if (n >= fadeOutStart)
+                    {
+                        gain = (fadeOutEnd - n - 0.5f) / crossfadeLength;
+                    }
+
+                    out[n] += gain * getStretchedSample(segment, channel, n);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the number of segments an IR is stretched in
+     *
+     * One per thread available, as long as each segment produces at least
+     * MIN_SEGMENT_LENGTH_S of output.
+     *
+     * @param [in] newNumSamples    Number of samples after stretching
+     */
+    int TimeStretch::getNumSegments(int newNumSamples) const
     {
-        if (!soundtouch)
+        if (sampleRate <= 0.0)
         {
-            logger.dualPrint(Logger::Level::Error, "No SoundTouch instance exists, cannot apply time stretch to IR");
-            return ir;
+            return 1;
         }
 
-        soundtouch->setChannels(1);
-        soundtouch->setSampleRate((unsigned)sampleRate);
+        const int numThreads = workerPool ? workerPool->getNumWorkers() + 1 : 1;
+        const int maxNumSegments = (int)(newNumSamples / (MIN_SEGMENT_LENGTH_S * sampleRate));
+
+        return juce::jlimit(1, MAX_NUM_SEGMENTS, std::min(numThreads, maxNumSegments));
+    }
+
+    /**
+     * @brief Stretches a segment of the IR with the segment's SoundTouch instance
+     *
+     * @param [in,out] segment  Segment to stretch
+     */
+    void TimeStretch::stretchSegment(Segment& segment)
+    {
+        auto& soundtouch = *segment.soundtouch;
+
+        soundtouch.setChannels((unsigned)numStretchChannels);
+        soundtouch.setSampleRate((unsigned)sampleRate);
+
+        soundtouch.clear();
+        soundtouch.setTempo(tempo);
+
+        // SoundTouch works on interleaved frames (the buffer is reused for the output,
+        // since putSamples() copies its input)
+        const int numInputFrames = segment.inputEnd - segment.inputStart;
+        const int maxNumOutputFrames = (int)std::ceil(numInputFrames / tempo) + 1;
 
-        // Calculate tempo change & expected number of samples in output buffer
-        int newNumSamples = getOutputNumSamples();
-        double sampleRateRatio = (double)irOrig.getNumSamples() / (double)newNumSamples;
+        segment.interleaved.resize((size_t)numStretchChannels *
+                                   (size_t)std::max(numInputFrames, maxNumOutputFrames));
+
+        std::vector<const float*> channels(numStretchChannels);
+
+        for (int channel = 0; channel < numStretchChannels; ++channel)
+        {
+            channels[channel] = irOrig->getReadPointer(channel, segment.inputStart);
+        }
 
-        // Use SoundTouch processor to calculate time stretch
-        soundtouch->clear();
-        soundtouch->setTempo(sampleRateRatio);
+        juce::AudioDataConverters::interleaveSamples(channels.data(),
+                                                     segment.interleaved.data(),
+                                                     numInputFrames,
+                                                     numStretchChannels);
 
-        soundtouch->putSamples(irOrig.getReadPointer(0), irOrig.getNumSamples());
+        soundtouch.putSamples(segment.interleaved.data(), (unsigned)numInputFrames);
 
         // Wait for processing to complete
         unsigned curSample = 0;
@@ -96,45 +303,451 @@ namespace reverb
         {
             curSample += nbSamplesReceived;
 
-            // Write processed samples to output buffer
-            auto curWritePtr = &ir.getChannelPointer(0)[curSample];
-            
-            nbSamplesReceived = soundtouch->receiveSamples(curWritePtr,
-                                                           (unsigned)ir.getNumSamples() - curSample);
+            // Write processed frames to segment buffer
+            auto curWritePtr = &segment.interleaved[(size_t)curSample * numStretchChannels];
+
+            nbSamplesReceived = soundtouch.receiveSamples(curWritePtr,
+                                                          (unsigned)maxNumOutputFrames - curSample);
         }
         while (nbSamplesReceived != 0);
 
         // Get last remaining samples from SoundTouch pipeline, if any
-        soundtouch->flush();
+        soundtouch.flush();
         do
         {
-            auto curWritePtr = &ir.getChannelPointer(0)[curSample];
+            auto curWritePtr = &segment.interleaved[(size_t)curSample * numStretchChannels];
 
-            nbSamplesReceived = soundtouch->receiveSamples(curWritePtr,
-                                                           (unsigned)ir.getNumSamples() - curSample);
+            nbSamplesReceived = soundtouch.receiveSamples(curWritePtr,
+                                                          (unsigned)maxNumOutputFrames - curSample);
 
             curSample += nbSamplesReceived;
         }
         while (nbSamplesReceived != 0);
 
-        jassert(curSample == ir.getNumSamples());
+        segment.numOutputFrames = (int)curSample;
+    }
 
-        // Reset mustExec flag
-        mustExec = false;
+    /**
+     * @brief Stretches a segment (worker pool job)
+     *
+     * Exceptions are kept in the segment, since they can't cross worker threads.
+     *
+     * @param [in] timeStretch  Pointer to TimeStretch object
+     * @param [in] segmentIdx   Index of segment to stretch
+     */
+    void TimeStretch::stretchSegmentJob(void* timeStretch, int segmentIdx)
+    {
+        auto self = static_cast<TimeStretch*>(timeStretch);
+        Segment& segment = self->segments[segmentIdx];
 
-        return ir;
+        try
+        {
+            self->stretchSegment(segment);
+        }
+        catch (...)
+        {
+            segment.error = std::current_exception();
+        }
+    }
+
+    /**
+     * @brief Finds the shift lining up a segment with the previous one
+     *
+     * Stretching segments independently doesn't keep them exactly in phase with each
+     * other. Maximises the cross-correlation of both segments over the crossfade.
+     *
+     * @param [in] previous         Previous segment
+     * @param [in] segment          Segment to align
+     * @param [in] boundary         Output position of the boundary between both segments
+     * @param [in] crossfadeLength  Crossfade length (samples)
+     * @param [in] maxLag           Maximum shift (samples)
+     *
+     * @returns Number of samples the segment should be moved earlier by
+     */
+    int TimeStretch::findAlignment(const Segment& previous, const Segment& segment,
+                                   int boundary, int crossfadeLength, int maxLag) const
+    {
+        const int start = boundary - crossfadeLength / 2;
+
+        int bestLag = 0;
+        double bestCorrelation = 0.0;
+
+        for (int lag = -maxLag; lag <= maxLag; ++lag)
+        {
+            double correlation = 0.0;
+
+            for (int channel = 0; channel < numStretchChannels; ++channel)
+            {
+                for (int n = start; n < start + crossfadeLength; ++n)
+                {
+                    correlation += getStretchedSample(previous, channel, n) *
+                                   getStretchedSample(segment, channel, n + lag);
+                }
+            }
+
+            if (correlation > bestCorrelation)
+            {
+                bestCorrelation = correlation;
+                bestLag = lag;
+            }
+        }
+
+        return bestLag;
+    }
+
+    /**
+     * @brief Returns a sample of a stretched segment at a given output position
+     *
+     * @returns Sample, or 0 if the segment doesn't cover that position
+     */
+    float TimeStretch::getStretchedSample(const Segment& segment, int channel, int position) const
+    {
+        const int frame = position - segment.outputOffset;
+
+        if (frame < 0 || frame >= segment.numOutputFrames)
+        {
+            return 0.0f;
+        }
+
+        return segment.interleaved[(size_t)frame * numStretchChannels + channel];
     }
 
     //==============================================================================
     /**
-     * @brief Copies given IR to internal representation and resizes it before processing
+     * @brief Change the IR length by reshaping its decay envelope
      *
-     * @param [in,out] ir   IR to copy and resize
+     * Estimates each channel's decay rate, then applies an exponential envelope so that
+     * the IR decays by 60 dB over its new length. Making the IR decay slower boosts it
+     * more and more over time, so the IR is only kept up to a maximum boost (beyond
+     * which its noise floor would be brought up) and the rest of the tail is synthesised
+     * from random grains of the kept part's late tail, decaying at the new rate (see
+     * extendTail()). The start of the IR (direct sound, early reflections) keeps its
+     * level.
+     *
+     * @param [in,out] ir   Audio sample buffer to process
+     */
+    void TimeStretch::reshapeEnvelope(AudioBlock ir)
+    {
+        juce::ScopedNoDenormals noDenormals;
+
+        const int numChannels = (int)ir.getNumChannels();
+        jassert(numChannels == irOrig->getNumChannels());
+
+        const int numSamples = irOrig->getNumSamples();
+        const int newNumSamples = (int)ir.getNumSamples();
+
+        // Decay rate (amplitude, per sample) reaching -60 dB at the end of the new IR
+        const double newDecayRate = std::log(1000.0) / std::max(newNumSamples, 1);
+        const double maxBoost = MAX_DECAY_BOOST_DB / 20.0 * std::log(10.0);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const float* src = irOrig->getReadPointer(channel);
+            float* dest = ir.getChannelPointer(channel);
+
+            const double decayRate = estimateDecayRate(src, numSamples);
+
+            int numKeptSamples = std::min(numSamples, newNumSamples);
+
+            if (decayRate > newDecayRate)
+            {
+                const double maxNumBoostedSamples = maxBoost / (decayRate - newDecayRate);
+
+                if (maxNumBoostedSamples < numKeptSamples)
+                {
+                    numKeptSamples = std::max((int)maxNumBoostedSamples, 1);
+                }
+            }
+
+            // Decay faster (shorten) or slower (lengthen) than the original IR
+            applyDecay(dest, src, numKeptSamples, newDecayRate - decayRate);
+            // Seeded per channel, so the output only depends on the parameters and the
+            // channels' tails are decorrelated
+            juce::Random random(TAIL_RANDOM_SEED + channel);
+            extendTail(dest, numKeptSamples, newNumSamples, newDecayRate, random);
+        }
+    }
+
+    /**
+     * @brief Estimates the decay rate of an IR
+     *
+     * Fits the energy decay curve (Schroeder backward integration) between
+     * DECAY_FIT_START_DB and DECAY_FIT_END_DB below the total IR energy. If the IR
+     * doesn't decay over that range, assumes it decays by 60 dB over its length.
+     *
+     * @param [in] ir           IR channel
+     * @param [in] numSamples   Number of samples in IR
+     *
+     * @returns Amplitude decay rate (nepers per sample)
+     */
+    double TimeStretch::estimateDecayRate(const float* ir, int numSamples)
+    {
+        const double defaultDecayRate = std::log(1000.0) / std::max(numSamples, 1);
+
+        double energy = 0.0;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            energy += (double)ir[i] * ir[i];
+        }
+
+        if (energy <= 0.0)
+        {
+            return defaultDecayRate;
+        }
+
+        // Find where the remaining energy crosses both ends of the fit range
+        const double startEnergy = energy * std::pow(10.0, -DECAY_FIT_START_DB / 10.0);
+        const double endEnergy = energy * std::pow(10.0, -DECAY_FIT_END_DB / 10.0);
+
+        int startIdx = -1;
+        int endIdx = -1;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            if (startIdx < 0 && energy <= startEnergy)
+            {
+                startIdx = i;
+            }
+
+            if (energy <= endEnergy)
+            {
+                endIdx = i;
+                break;
+            }
+
+            energy -= (double)ir[i] * ir[i];
+        }
+
+        if (startIdx < 0 || endIdx <= startIdx)
+        {
+            return defaultDecayRate;
+        }
+
+        // Energy and amplitude drop by the same number of dB
+        const double dropNepers = (DECAY_FIT_END_DB - DECAY_FIT_START_DB) / 20.0 * std::log(10.0);
+
+        return dropNepers / (endIdx - startIdx);
+    }
+
+    /**
+     * @brief Applies an exponential decay envelope to an IR
+     *
+     * The envelope is built once for a block of samples, then scaled for each block, so
+     * the IR is processed with vector operations only.
+     *
+     * @param [out] dest        Output buffer
+     * @param [in]  src         Input buffer
+     * @param [in]  numSamples  Number of samples to process
+     * @param [in]  decayRate   Envelope decay rate (nepers per sample, negative to boost)
+     */
+    void TimeStretch::applyDecay(float* dest, const float* src, int numSamples, double decayRate)
+    {
+        float envelope[ENVELOPE_BLOCK_SIZE];
+
+        for (int i = 0; i < ENVELOPE_BLOCK_SIZE; ++i)
+        {
+            envelope[i] = (float)std::exp(-decayRate * i);
+        }
+
+        const double blockGainStep = std::exp(-decayRate * ENVELOPE_BLOCK_SIZE);
+        double blockGain = 1.0;
+
+        for (int start = 0; start < numSamples; start += ENVELOPE_BLOCK_SIZE)
+        {
+            const int blockSize = std::min(ENVELOPE_BLOCK_SIZE, numSamples - start);
+
+            juce::FloatVectorOperations::multiply(dest + start, src + start, envelope, blockSize);
+            juce::FloatVectorOperations::multiply(dest + start, (float)blockGain, blockSize);
+
+            blockGain *= blockGainStep;
+        }
+    }
+
+    /**
+     * @brief Extends an IR with a synthesised tail decaying at a given rate
+     *
+     * The tail is an overlap-add of grains drawn at random from the late part of the IR
+     * (with its decay taken out and its mean removed), each played forwards or backwards
+     * with a random sign. Grains are shaped by a sine window, so that consecutive
+     * (uncorrelated) grains sum to a constant power, and by the tail's decay. The tail
+     * thus has the late IR's spectrum but never repeats, and starts at the IR's level.
+     * It is crossfaded in over the last half grain of the IR.
+     *
+     * If too little of the IR is left to draw grains from, they are drawn from white
+     * noise instead. An empty IR is extended with silence.
+     *
+     * @param [in,out] ir               IR buffer (holding newNumSamples samples)
+     * @param [in]     numSamples       Number of samples in the IR
+     * @param [in]     newNumSamples    Number of samples after extension
+     * @param [in]     decayRate        Tail decay rate (nepers per sample)
+     * @param [in]     random           Random generator used to pick grains
+     */
+    void TimeStretch::extendTail(float* ir, int numSamples, int newNumSamples, double decayRate,
+                                 juce::Random& random)
+    {
+        if (newNumSamples <= numSamples)
+        {
+            return;
+        }
+
+        juce::FloatVectorOperations::clear(ir + numSamples, newNumSamples - numSamples);
+
+        if (numSamples == 0)
+        {
+            return;
+        }
+
+        // Grain source: late part of the IR with its decay taken out, or white noise
+        const int sourceStart = std::max(numSamples / 2, numSamples - MAX_TAIL_SOURCE_SIZE);
+        int sourceSize = numSamples - sourceStart;
+        int grainSize = std::min(TAIL_GRAIN_SIZE, sourceSize / TAIL_SOURCE_GRAIN_RATIO) & ~1;
+
+        std::vector<float> source;
+
+        if (grainSize >= MIN_TAIL_GRAIN_SIZE)
+        {
+            source.resize((size_t)sourceSize);
+
+            for (int i = 0; i < sourceSize; ++i)
+            {
+                source[i] = ir[sourceStart + i] * (float)std::exp(decayRate * i);
+            }
+        }
+        else
+        {
+            grainSize = TAIL_GRAIN_SIZE;
+            sourceSize = TAIL_SOURCE_GRAIN_RATIO * TAIL_GRAIN_SIZE;
+            source.resize((size_t)sourceSize);
+
+            for (auto& sample : source)
+            {
+                sample = random.nextFloat() * 2.0f - 1.0f;
+            }
+        }
+
+        // Remove DC, which would otherwise build up into a low-frequency drift
+        double mean = 0.0;
+
+        for (const float sample : source)
+        {
+            mean += sample;
+        }
+
+        mean /= sourceSize;
+
+        double sourceEnergy = 0.0;
+
+        for (auto& sample : source)
+        {
+            sample -= (float)mean;
+            sourceEnergy += (double)sample * sample;
+        }
+
+        const double sourceRMS = std::sqrt(sourceEnergy / sourceSize);
+
+        if (sourceRMS <= 0.0)
+        {
+            return;
+        }
+
+        const int hopSize = grainSize / 2;
+        const int fadeLength = std::min(hopSize, numSamples);
+        const int tailStart = numSamples - fadeLength;
+
+        // Level of the IR where the tail starts, from the RMS over its last grain
+        const int levelSize = std::min(grainSize, numSamples);
+        double levelEnergy = 0.0;
+
+        for (int i = numSamples - levelSize; i < numSamples; ++i)
+        {
+            levelEnergy += (double)ir[i] * ir[i];
+        }
+
+        const double levelCentre = numSamples - levelSize / 2.0;
+        const double tailLevel = std::sqrt(levelEnergy / levelSize) * std::exp(-decayRate * (tailStart - levelCentre));
+
+        // Crossfade from the end of the IR into the tail
+        for (int i = 0; i < fadeLength; ++i)
+        {
+            ir[tailStart + i] *= (float)std::cos(0.5 * juce::MathConstants<double>::pi * (i + 0.5) / fadeLength);
+        }
+
+        // Grain window, including the decay over one grain
+        std::vector<float> window((size_t)grainSize);
+
+        for (int i = 0; i < grainSize; ++i)
+        {
+            window[i] = (float)(std::sin(juce::MathConstants<double>::pi * (i + 0.5) / grainSize) *
+                                std::exp(-decayRate * i));
+        }
+
+        // Overlap-add grains, the first one rising over the crossfade
+        for (int grainStart = numSamples - hopSize; grainStart < newNumSamples; grainStart += hopSize)
+        {
+            const int position = random.nextInt(sourceSize - grainSize + 1);
+            const bool isReversed = random.nextBool();
+            const double sign = random.nextBool() ? 1.0 : -1.0;
+
+            const float gain = (float)(sign * tailLevel / sourceRMS * std::exp(-decayRate * (grainStart - tailStart)));
+
+            const int begin = std::max(tailStart - grainStart, 0);
+            const int end = std::min(grainSize, newNumSamples - grainStart);
+
+            for (int i = begin; i < end; ++i)
+            {
+                const float sample = source[position + (isReversed ? grainSize - 1 - i : i)];
+                ir[grainStart + i] += gain * window[i] * sample;
+            }
+        }
+    }
+
+    //==============================================================================
+    /**
+     * @brief Moves given IR to internal representation and resizes it before processing
+     *
+     * The internal copy is released by exec().
+     *
+     * @param [in,out] ir   IR to take over, resized to the output length (contents undefined)
      */
     void TimeStretch::prepareIR(juce::AudioSampleBuffer& ir)
     {
-        irOrig.makeCopyOf(ir);
-        ir.setSize(ir.getNumChannels(), getOutputNumSamples());
+        // Take over input samples rather than copying them (long IRs are large)
+        const int numChannels = ir.getNumChannels();
+
+        irOrig = std::make_shared<const juce::AudioSampleBuffer>(std::move(ir));
+        ir.setSize(numChannels, getOutputNumSamples());
+    }
+
+    /**
+     * @brief Shares given IR as input and resizes the output buffer before processing
+     *
+     * The input is only read, so it may be shared with other owners (e.g. a cache of
+     * pipeline stage outputs). It is released by exec().
+     *
+     * @param [in]  ir      IR to process
+     * @param [out] output  Output buffer, resized to the output length (contents undefined)
+     */
+    void TimeStretch::prepareIR(std::shared_ptr<const juce::AudioSampleBuffer> ir,
+                                juce::AudioSampleBuffer& output)
+    {
+        const int numChannels = ir->getNumChannels();
+
+        irOrig = std::move(ir);
+        output.setSize(numChannels, getOutputNumSamples());
+    }
+
+    /**
+     * @brief Sets the worker pool segments of long IRs are stretched on
+     *
+     * The pool must outlive this object, or be unset first. Without a pool, IRs are
+     * stretched in one piece.
+     *
+     * @param [in] pool Worker pool (may be null)
+     */
+    void TimeStretch::setWorkerPool(WorkerPool* pool)
+    {
+        workerPool = pool;
     }
 
     /**
@@ -11,6 +11,10 @@
 #include "SoundTouch.h"
 
 #include "Task.h"
+#include "WorkerPool.h"
+
+#include <exception>
+#include <vector>
 
 namespace reverb
 {
@@ -18,6 +22,17 @@ namespace reverb
     //==============================================================================
     /**
      * Implements a time stretching algorithm to manage IR buffer length and sample rate.
+     *
+     * All channels of the IR are stretched together. Long IRs are split into overlapping
+     * segments, each stretched by its own SoundTouch instance (in parallel if a worker
+     * pool is set). Segments are aligned with each other by cross-correlation, so they
+     * can be crossfaded without phase cancellation.
+     *
+     * Alternatively, the IR length can be changed by reshaping its decay envelope: the
+     * IR is shortened by making it decay faster, and lengthened by making it decay
+     * slower and extending its tail with noise-like grains of its late part, decaying at
+     * the new rate. This runs in linear time and keeps the early part of the IR at its
+     * original level.
      */
     class TimeStretch : public Task
     {
@@ -35,21 +50,113 @@ namespace reverb
 
         virtual AudioBlock exec(AudioBlock ir) override;
 
+        //==============================================================================
+        enum class LengthMode
+        {
+            SoundTouch,     // Time stretch the whole IR
+            Envelope        // Reshape the decay envelope and extend the tail
+        };
+
+        void setLengthMode(LengthMode mode);
+        LengthMode getLengthMode() const { return lengthMode; }
+
+        float getIRLength() const { return irLengthS; }
+
+        // Flags the current parameters as applied (e.g. output was taken from a cache)
+        void setUpToDate() { mustExec = false; }
+
         //==============================================================================
         void prepareIR(juce::AudioSampleBuffer& ir);
+        void prepareIR(std::shared_ptr<const juce::AudioSampleBuffer> ir, juce::AudioSampleBuffer& output);
         int getOutputNumSamples();
 
+        void setWorkerPool(WorkerPool* pool);
+
     protected:
         //==============================================================================
         static constexpr double MAX_IR_LENGTH_S = 5.0f;
 
         float irLengthS = 3.0f;
 
+        LengthMode lengthMode = LengthMode::SoundTouch;
+
         //==============================================================================
-        juce::AudioSampleBuffer irOrig;
+        void stretch(AudioBlock ir);
+        void reshapeEnvelope(AudioBlock ir);
+
+        static double estimateDecayRate(const float* ir, int numSamples);
+        static void applyDecay(float* dest, const float* src, int numSamples, double decayRate);
+        static void extendTail(float* ir, int numSamples, int newNumSamples, double decayRate,
+                               juce::Random& random);
+
+        // Range of the energy decay curve used to estimate the decay rate (dB)
+        static constexpr double DECAY_FIT_START_DB = 5.0;
+        static constexpr double DECAY_FIT_END_DB = 25.0;
+
+        // Maximum boost applied to the end of an IR made to decay slower (dB)
+        static constexpr double MAX_DECAY_BOOST_DB = 24.0;
+
+        static constexpr int ENVELOPE_BLOCK_SIZE = 256;
+
+        // Grains of the late IR overlap-added into an extended tail (samples). Grains are
+        // drawn from at most the last MAX_TAIL_SOURCE_SIZE samples and are shortened to
+        // fit TAIL_SOURCE_GRAIN_RATIO times into them, down to MIN_TAIL_GRAIN_SIZE.
+        static constexpr int TAIL_GRAIN_SIZE = 1024;
+        static constexpr int MIN_TAIL_GRAIN_SIZE = 64;
+        static constexpr int TAIL_SOURCE_GRAIN_RATIO = 4;
+        static constexpr int MAX_TAIL_SOURCE_SIZE = 65536;
+        static constexpr juce::int64 TAIL_RANDOM_SEED = 0x5eed;
 
         //==============================================================================
-        std::unique_ptr<soundtouch::SoundTouch> soundtouch;
+        // Part of the IR stretched by one SoundTouch instance
+        struct Segment
+        {
+            std::unique_ptr<soundtouch::SoundTouch> soundtouch;
+
+            int inputStart = 0;             // First input frame
+            int inputEnd = 0;               // Last input frame + 1
+            int outputOffset = 0;           // Output position of first stretched frame
+
+            // Interleaved samples exchanged with SoundTouch
+            std::vector<float> interleaved;
+            int numOutputFrames = 0;
+
+            std::exception_ptr error;
+        };
+
+        int getNumSegments(int newNumSamples) const;
+        void stretchSegment(Segment& segment);
+        static void stretchSegmentJob(void* timeStretch, int segmentIdx);
+
+        int findAlignment(const Segment& previous, const Segment& segment,
+                          int boundary, int crossfadeLength, int maxLag) const;
+
+        float getStretchedSample(const Segment& segment, int channel, int position) const;
+
+        // Minimum length of the output of each segment, i.e. length below which an IR
+        // is stretched in one piece (s)
+        static constexpr double MIN_SEGMENT_LENGTH_S = 0.5;
+        static constexpr int MAX_NUM_SEGMENTS = 16;
+
+        // Extra output stretched on both sides of a segment, so SoundTouch's start-up
+        // and flush don't affect the part that is kept (s)
+        static constexpr double SEGMENT_MARGIN_S = 0.1;
+
+        // Crossfade between consecutive segments (s)
+        static constexpr double SEGMENT_CROSSFADE_S = 0.02;
+
+        // Maximum shift applied to a segment to line it up with the previous one (s)
+        static constexpr double MAX_SEGMENT_ALIGNMENT_S = 0.015;
+
+        //==============================================================================
+        // Input IR, from prepareIR() until exec() is done with it
+        std::shared_ptr<const juce::AudioSampleBuffer> irOrig;
+
+        std::vector<Segment> segments;
+        int numStretchChannels = 0;
+        double tempo = 1.0;
+
+        WorkerPool* workerPool = nullptr;
     };
 
 }
@@ -89,6 +89,12 @@ namespace reverb
             AudioBlock ir = processor.mainPipelines[channel]->ir;
             double sampleRate = processor.mainPipelines[channel]->sampleRate;
 
+            // Skip pipelines without an IR (e.g. unused in true-stereo mode)
+            if (ir.getNumSamples() == 0)
+            {
+                continue;
+            }
+
             int samplesPerStep = (int)std::ceil(GRAPH_TIME_STEP_S * sampleRate);
             int numSteps = (int)std::ceil(GRAPH_TOTAL_TIME_S / GRAPH_TIME_STEP_S);
 
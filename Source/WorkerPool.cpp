@@ -0,0 +1,284 @@
+/*
+  ==============================================================================
+
+    WorkerPool.cpp
+
+  ==============================================================================
+*/
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * @brief Hints the CPU that we are busy-waiting
+     */
+    static inline void spinPause()
+    {
+#if JUCE_INTEL
+        _mm_pause();
+#endif
+    }
+
+    //==============================================================================
+    /**
+     * @brief Constructs a WorkerPool and starts its threads
+     *
+     * @param [in] numWorkers   Number of worker threads (in addition to the caller of run())
+     * @param [in] isRealtime   True to run workers at time-critical priority and spin
+     *                          between batches
+     */
+    WorkerPool::WorkerPool(int numWorkers, bool isRealtime)
+        : isRealtime(isRealtime)
+    {
+        setSpinTime(DEFAULT_SPIN_TIME_S);
+
+        for (int i = 0; i < numWorkers; ++i)
+        {
+            workers.emplace_back(new Worker());
+        }
+
+        for (int i = 0; i < numWorkers; ++i)
+        {
+            workers[i]->thread = std::thread(&WorkerPool::workerLoop, this, i);
+        }
+    }
+
+    /**
+     * @brief Wakes up and joins all worker threads
+     */
+    WorkerPool::~WorkerPool()
+    {
+        shouldExit = true;
+
+        for (auto& worker : workers)
+        {
+            worker->wakeUp.signal();
+        }
+
+        for (auto& worker : workers)
+        {
+            worker->thread.join();
+        }
+    }
+
+    //==============================================================================
+    /**
+     * @brief Returns the number of workers waiting for a wake-up call
+     */
+    int WorkerPool::getNumParkedWorkers() const
+    {
+        return (int)std::count_if(workers.begin(), workers.end(),
+                                  [](const std::unique_ptr<Worker>& worker) { return worker->parked.load(); });
+    }
+
+    /**
+     * @brief Sets how long idle workers of a realtime pool spin before parking
+     *
+     * Should be a bit longer than the period of the callbacks calling run(), so that
+     * workers only park (and need a system call to be woken up) once callbacks stop.
+     *
+     * @param [in] seconds  Spin time
+     */
+    void WorkerPool::setSpinTime(double seconds)
+    {
+        spinTicks = (juce::int64)(seconds * (double)juce::Time::getHighResolutionTicksPerSecond());
+    }
+
+    /**
+     * @brief Runs a batch of jobs and waits for all of them to complete
+     *
+     * Publishes the batch, wakes up parked workers, then runs jobs on the calling thread
+     * until none are left and waits for the workers to be done with theirs: realtime pools
+     * spin, other pools sleep until the last job is done (and first wait for any batch
+     * run from another thread to complete).
+     *
+     * @param [in] numJobs  Number of jobs (job indices 0 to numJobs - 1)
+     * @param [in] job      Function to run for each job
+     * @param [in] context  Pointer passed to each job
+     */
+    void WorkerPool::run(int numJobs, Job job, void* context)
+    {
+        jassert(numJobs <= MAX_NUM_JOBS);
+
+        if (numJobs <= 0)
+        {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(runLock, std::defer_lock);
+
+        if (!isRealtime)
+        {
+            lock.lock();
+
+            // Drop the signal left by a previous batch whose last job ran on its caller
+            batchDone.reset();
+        }
+
+        // Publish batch (the state store releases the job description)
+        this->job.store(job, std::memory_order_relaxed);
+        this->context.store(context, std::memory_order_relaxed);
+        numPendingJobs.store(numJobs, std::memory_order_relaxed);
+
+        ++generation;
+        state.store(((uint64_t)generation << 32) | ((uint64_t)numJobs << 16));
+
+        // Wake up parked workers
+        for (auto& worker : workers)
+        {
+            if (worker->parked.exchange(false))
+            {
+                worker->wakeUp.signal();
+            }
+        }
+
+        // Help out, then wait for jobs claimed by workers
+        runJobs(generation);
+
+        while (numPendingJobs.load(std::memory_order_acquire) > 0)
+        {
+            if (isRealtime)
+            {
+                spinPause();
+            }
+            else
+            {
+                batchDone.wait();
+            }
+        }
+    }
+
+    //==============================================================================
+    /**
+     * @brief Claims and runs jobs from a given batch until there are none left
+     *
+     * Jobs are claimed by incrementing the job index in the state word. The claim only
+     * succeeds if the state still belongs to the given batch, so a late worker can never
+     * run a job from a batch it has not seen being published.
+     *
+     * @param [in] generation   Batch to run jobs from
+     */
+    void WorkerPool::runJobs(uint32_t generation)
+    {
+        for (;;)
+        {
+            uint64_t currentState = state.load(std::memory_order_acquire);
+
+            if ((uint32_t)(currentState >> 32) != generation)
+            {
+                return;
+            }
+
+            const int jobIdx = (int)(currentState & 0xFFFF);
+            const int numJobs = (int)((currentState >> 16) & 0xFFFF);
+
+            if (jobIdx >= numJobs)
+            {
+                return;
+            }
+
+            // Only valid if the claim below succeeds (the batch is then still running)
+            Job currentJob = job.load(std::memory_order_relaxed);
+            void* currentContext = context.load(std::memory_order_relaxed);
+
+            if (!state.compare_exchange_weak(currentState, currentState + 1,
+                                             std::memory_order_acq_rel))
+            {
+                continue;
+            }
+
+            currentJob(currentContext, jobIdx);
+
+            if (numPendingJobs.fetch_sub(1, std::memory_order_acq_rel) == 1 && !isRealtime)
+            {
+                batchDone.signal();
+            }
+        }
+    }
+
+    /**
+     * @brief Worker thread body: spin while work may be coming (realtime pools only),
+     * park otherwise
+     *
+     * @param [in] workerIdx    Index of worker running this loop
+     */
+    void WorkerPool::workerLoop(int workerIdx)
+    {
+#ifdef WIN32
+        SetThreadPriority(GetCurrentThread(),
+                          isRealtime ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_MODE_BACKGROUND_BEGIN);
+#endif
+
+        Worker& worker = *workers[workerIdx];
+
+        uint32_t lastGeneration = 0;
+        juce::int64 idleSinceTicks = juce::Time::getHighResolutionTicks();
+
+        while (!shouldExit)
+        {
+            const uint32_t currentGeneration = (uint32_t)(state.load(std::memory_order_acquire) >> 32);
+
+            if (currentGeneration != lastGeneration)
+            {
+                lastGeneration = currentGeneration;
+                runJobs(currentGeneration);
+
+                idleSinceTicks = juce::Time::getHighResolutionTicks();
+                continue;
+            }
+
+            if (isRealtime && juce::Time::getHighResolutionTicks() - idleSinceTicks <
+                              spinTicks.load(std::memory_order_relaxed))
+            {
+                spinPause();
+                continue;
+            }
+
+            // Park, unless a batch was published since we last checked
+            worker.parked = true;
+
+            if ((uint32_t)(state.load() >> 32) != lastGeneration || shouldExit)
+            {
+                worker.parked = false;
+                continue;
+            }
+
+            worker.wakeUp.wait();
+            idleSinceTicks = juce::Time::getHighResolutionTicks();
+        }
+    }
+
+    //==============================================================================
+    /**
+     * @brief Constructs the background pool and starts its (background priority) threads
+     */
+    BackgroundWorkerPool::BackgroundWorkerPool()
+        : WorkerPool(getNumBackgroundWorkers(), false)
+    {
+    }
+
+    /**
+     * @brief Returns the number of workers needed to use every core (up to
+     * MAX_NUM_THREADS) along with the caller of run()
+     */
+    int BackgroundWorkerPool::getNumBackgroundWorkers()
+    {
+        const int numThreads = std::min((int)std::thread::hardware_concurrency(), MAX_NUM_THREADS);
+
+        return std::max(numThreads - 1, 0);
+    }
+
+}
@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+    WorkerPool.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#include "Semaphore.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace reverb
+{
+
+    //==============================================================================
+    /**
+     * Persistent pool of worker threads for running a batch of jobs (e.g. one per
+     * channel) in parallel from the audio thread.
+     *
+     * The calling thread takes part in the work and then waits until all jobs are done.
+     *
+     * Realtime pools (for the audio thread) run their workers at the highest priority.
+     * Their run() neither allocates nor blocks: the caller spins on the last jobs, and
+     * idle workers spin for a while (set to a bit more than the callback period), which
+     * keeps them hot between consecutive audio callbacks, then park on a semaphore once
+     * callbacks stop. Only parked workers need a (lock-free) wake-up call. run() must only
+     * be called from one thread at a time.
+     *
+     * Other pools (e.g. for background IR processing) run their workers at background
+     * priority and never spin: workers park as soon as they are idle and the caller
+     * sleeps until the last job signals it. They may be shared, concurrent run() calls
+     * then take turns.
+     */
+    class WorkerPool
+    {
+    public:
+        //==============================================================================
+        WorkerPool(int numWorkers, bool isRealtime = true);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        //==============================================================================
+        using Job = void (*)(void* context, int jobIdx);
+
+        void run(int numJobs, Job job, void* context);
+
+        int getNumWorkers() const { return (int)workers.size(); }
+        int getNumParkedWorkers() const;
+
+        void setSpinTime(double seconds);
+
+        //==============================================================================
+        // Time an idle realtime worker spins before parking, until set otherwise
+        static constexpr double DEFAULT_SPIN_TIME_S = 0.002;
+
+        static constexpr int MAX_NUM_JOBS = 0xFFFF;
+
+    private:
+        //==============================================================================
+        void workerLoop(int workerIdx);
+        void runJobs(uint32_t generation);
+
+        const bool isRealtime;
+
+        //==============================================================================
+        struct Worker
+        {
+            std::thread thread;
+            Semaphore wakeUp;
+            std::atomic<bool> parked { false };
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+
+        // Batch generation (high 32 bits), number of jobs (next 16 bits) and index of
+        // next unclaimed job (low 16 bits), updated together so a claim always sees
+        // a consistent batch
+        std::atomic<uint64_t> state { 0 };
+        uint32_t generation = 0;
+
+        std::atomic<Job> job { nullptr };
+        std::atomic<void*> context { nullptr };
+        std::atomic<int> numPendingJobs { 0 };
+
+        // Non-realtime pools only: signalled when the last job of a batch is done, and
+        // held by the caller of run() for the whole batch
+        juce::WaitableEvent batchDone;
+        std::mutex runLock;
+
+        // Realtime pools only, in high resolution ticks
+        std::atomic<juce::int64> spinTicks;
+
+        std::atomic<bool> shouldExit { false };
+    };
+
+    //==============================================================================
+    /**
+     * Background pool shared by all plugin instances through a juce::SharedResourcePointer,
+     * with one thread per core (up to MAX_NUM_THREADS), counting the caller of run().
+     */
+    class BackgroundWorkerPool : public WorkerPool
+    {
+    public:
+        //==============================================================================
+        BackgroundWorkerPool();
+
+        //==============================================================================
+        static constexpr int MAX_NUM_THREADS = 16;
+
+    private:
+        //==============================================================================
+        static int getNumBackgroundWorkers();
+    };
+
+}